@@ -0,0 +1,27 @@
+#pragma once
+#include <glm/glm.hpp>
+
+enum class ActorType { Passenger, Control };
+enum class ActorAnim { None, Entering, Inside, Exiting };
+
+struct Actor
+{
+    int id = 0;
+    ActorType type = ActorType::Passenger;
+
+    int modelIndex = 0;
+    ActorAnim anim = ActorAnim::None;
+
+    glm::vec3 pos = glm::vec3(0.0f);
+    glm::vec3 startPos = glm::vec3(0.0f);
+
+    glm::vec3 midPos = glm::vec3(0.0f);
+    bool useMid = false;
+
+    glm::vec3 endPos = glm::vec3(0.0f);
+
+    float t = 0.0f;
+    float duration = 1.0f; 
+
+    int seat = -1;   // into BusGeometry::seats while it holds one
+};
@@ -0,0 +1,215 @@
+#include "ActorAnimKernel.h"
+#include "CpuFeatures.h"
+#include <algorithm>
+
+void ActorPaths::clear()
+{
+    resize(0);
+}
+
+void ActorPaths::reserve(int n)
+{
+    for (std::vector<float>* v : { &t, &invDuration, &split, &invLeg0, &invLeg1,
+                                   &startX, &startY, &startZ, &midX, &midY, &midZ,
+                                   &endX, &endY, &endZ, &posX, &posY, &posZ })
+        v->reserve(n);
+}
+
+void ActorPaths::push(const Actor& a)
+{
+    glm::vec3 mid = a.useMid ? a.midPos : a.endPos;
+    float s = a.useMid ? 0.5f : 1.0f;
+
+    t.push_back(a.t);
+    invDuration.push_back(1.0f / std::max(0.001f, a.duration));
+
+    split.push_back(s);
+    invLeg0.push_back(1.0f / s);
+    invLeg1.push_back(a.useMid ? 1.0f / (1.0f - s) : 0.0f);
+
+    startX.push_back(a.startPos.x); startY.push_back(a.startPos.y); startZ.push_back(a.startPos.z);
+    midX.push_back(mid.x);          midY.push_back(mid.y);          midZ.push_back(mid.z);
+    endX.push_back(a.endPos.x);     endY.push_back(a.endPos.y);     endZ.push_back(a.endPos.z);
+    posX.push_back(a.pos.x);        posY.push_back(a.pos.y);        posZ.push_back(a.pos.z);
+}
+
+void ActorPaths::move(int dst, int src)
+{
+    for (std::vector<float>* v : { &t, &invDuration, &split, &invLeg0, &invLeg1,
+                                   &startX, &startY, &startZ, &midX, &midY, &midZ,
+                                   &endX, &endY, &endZ, &posX, &posY, &posZ })
+        (*v)[dst] = (*v)[src];
+}
+
+void ActorPaths::resize(int n)
+{
+    for (std::vector<float>* v : { &t, &invDuration, &split, &invLeg0, &invLeg1,
+                                   &startX, &startY, &startZ, &midX, &midY, &midZ,
+                                   &endX, &endY, &endZ, &posX, &posY, &posZ })
+        v->resize(n);
+}
+
+static void AdvanceScalar(ActorPaths& p, int begin, int end, float dt)
+{
+    for (int i = begin; i < end; i++)
+    {
+        float t = p.t[i] + dt * p.invDuration[i];
+        p.t[i] = t;
+
+        float t01 = std::min(std::max(t, 0.0f), 1.0f);
+        bool second = t01 > p.split[i];
+
+        float u = second ? (t01 - p.split[i]) * p.invLeg1[i] : t01 * p.invLeg0[i];
+        u = std::min(std::max(u, 0.0f), 1.0f);
+        float k = u * u * (3.0f - 2.0f * u);
+
+        float ax = second ? p.midX[i] : p.startX[i];
+        float ay = second ? p.midY[i] : p.startY[i];
+        float az = second ? p.midZ[i] : p.startZ[i];
+        float bx = second ? p.endX[i] : p.midX[i];
+        float by = second ? p.endY[i] : p.midY[i];
+        float bz = second ? p.endZ[i] : p.midZ[i];
+
+        p.posX[i] = ax + (bx - ax) * k;
+        p.posY[i] = ay + (by - ay) * k;
+        p.posZ[i] = az + (bz - az) * k;
+    }
+}
+
+#if SIMD_X86
+
+static int AdvanceSSE(ActorPaths& p, int begin, int end, float dt)
+{
+    const __m128 vdt = _mm_set1_ps(dt);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 three = _mm_set1_ps(3.0f);
+
+    int i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 t = _mm_add_ps(_mm_loadu_ps(&p.t[i]), _mm_mul_ps(vdt, _mm_loadu_ps(&p.invDuration[i])));
+        _mm_storeu_ps(&p.t[i], t);
+
+        __m128 t01 = _mm_min_ps(_mm_max_ps(t, zero), one);
+        __m128 split = _mm_loadu_ps(&p.split[i]);
+        __m128 second = _mm_cmpgt_ps(t01, split);
+
+        __m128 u0 = _mm_mul_ps(t01, _mm_loadu_ps(&p.invLeg0[i]));
+        __m128 u1 = _mm_mul_ps(_mm_sub_ps(t01, split), _mm_loadu_ps(&p.invLeg1[i]));
+        __m128 u = _mm_or_ps(_mm_and_ps(second, u1), _mm_andnot_ps(second, u0));
+        u = _mm_min_ps(_mm_max_ps(u, zero), one);
+        __m128 k = _mm_mul_ps(_mm_mul_ps(u, u), _mm_sub_ps(three, _mm_mul_ps(two, u)));
+
+        const float* from[3] = { &p.startX[i], &p.startY[i], &p.startZ[i] };
+        const float* mid[3] = { &p.midX[i], &p.midY[i], &p.midZ[i] };
+        const float* to[3] = { &p.endX[i], &p.endY[i], &p.endZ[i] };
+        float* out[3] = { &p.posX[i], &p.posY[i], &p.posZ[i] };
+
+        for (int c = 0; c < 3; c++)
+        {
+            __m128 s = _mm_loadu_ps(from[c]);
+            __m128 m = _mm_loadu_ps(mid[c]);
+            __m128 e = _mm_loadu_ps(to[c]);
+
+            __m128 a = _mm_or_ps(_mm_and_ps(second, m), _mm_andnot_ps(second, s));
+            __m128 b = _mm_or_ps(_mm_and_ps(second, e), _mm_andnot_ps(second, m));
+            _mm_storeu_ps(out[c], _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), k)));
+        }
+    }
+    return i;
+}
+
+SIMD_TARGET_AVX2
+static int AdvanceAVX2(ActorPaths& p, int begin, int end, float dt)
+{
+    const __m256 vdt = _mm256_set1_ps(dt);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 three = _mm256_set1_ps(3.0f);
+
+    int i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 t = _mm256_add_ps(_mm256_loadu_ps(&p.t[i]), _mm256_mul_ps(vdt, _mm256_loadu_ps(&p.invDuration[i])));
+        _mm256_storeu_ps(&p.t[i], t);
+
+        __m256 t01 = _mm256_min_ps(_mm256_max_ps(t, zero), one);
+        __m256 split = _mm256_loadu_ps(&p.split[i]);
+        __m256 second = _mm256_cmp_ps(t01, split, _CMP_GT_OQ);
+
+        __m256 u0 = _mm256_mul_ps(t01, _mm256_loadu_ps(&p.invLeg0[i]));
+        __m256 u1 = _mm256_mul_ps(_mm256_sub_ps(t01, split), _mm256_loadu_ps(&p.invLeg1[i]));
+        __m256 u = _mm256_blendv_ps(u0, u1, second);
+        u = _mm256_min_ps(_mm256_max_ps(u, zero), one);
+        __m256 k = _mm256_mul_ps(_mm256_mul_ps(u, u), _mm256_sub_ps(three, _mm256_mul_ps(two, u)));
+
+        const float* from[3] = { &p.startX[i], &p.startY[i], &p.startZ[i] };
+        const float* mid[3] = { &p.midX[i], &p.midY[i], &p.midZ[i] };
+        const float* to[3] = { &p.endX[i], &p.endY[i], &p.endZ[i] };
+        float* out[3] = { &p.posX[i], &p.posY[i], &p.posZ[i] };
+
+        for (int c = 0; c < 3; c++)
+        {
+            __m256 s = _mm256_loadu_ps(from[c]);
+            __m256 m = _mm256_loadu_ps(mid[c]);
+            __m256 e = _mm256_loadu_ps(to[c]);
+
+            __m256 a = _mm256_blendv_ps(s, m, second);
+            __m256 b = _mm256_blendv_ps(m, e, second);
+            _mm256_storeu_ps(out[c], _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), k)));
+        }
+    }
+    return i;
+}
+
+#endif
+
+bool AnimKernelSupported(AnimKernel kernel)
+{
+#if SIMD_X86
+    if (kernel == AnimKernel::AVX2) return CpuHasAVX2();
+    return true;   // SSE2 is part of x86-64 and of every CPU this runs on
+#else
+    return kernel == AnimKernel::Scalar;
+#endif
+}
+
+AnimKernel AnimKernelBest()
+{
+    if (AnimKernelSupported(AnimKernel::AVX2)) return AnimKernel::AVX2;
+    if (AnimKernelSupported(AnimKernel::SSE)) return AnimKernel::SSE;
+    return AnimKernel::Scalar;
+}
+
+const char* AnimKernelName(AnimKernel kernel)
+{
+    switch (kernel)
+    {
+    case AnimKernel::SSE: return "sse";
+    case AnimKernel::AVX2: return "avx2";
+    default: return "scalar";
+    }
+}
+
+void AdvanceActorPaths(ActorPaths& p, int begin, int end, float dt, AnimKernel kernel)
+{
+    if (!AnimKernelSupported(kernel)) kernel = AnimKernel::Scalar;
+
+    int done = begin;
+#if SIMD_X86
+    if (kernel == AnimKernel::AVX2) done = AdvanceAVX2(p, begin, end, dt);
+    else if (kernel == AnimKernel::SSE) done = AdvanceSSE(p, begin, end, dt);
+#endif
+
+    // Tail (and the whole range for the scalar kernel).
+    AdvanceScalar(p, done, end, dt);
+}
+
+void AdvanceActorPaths(ActorPaths& p, float dt)
+{
+    static const AnimKernel best = AnimKernelBest();
+    AdvanceActorPaths(p, 0, p.size(), dt, best);
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include "Actor.h"
+
+enum class AnimKernel { Scalar, SSE, AVX2 };
+
+// Door animations in SoA form. Every path has two smoothstep legs,
+// start -> mid over [0, split] and mid -> end over [split, 1]; a straight
+// path uses mid = end and split = 1 so the second leg is never reached.
+struct ActorPaths
+{
+    std::vector<float> t;
+    std::vector<float> invDuration;
+
+    std::vector<float> split;
+    std::vector<float> invLeg0;   // 1 / split
+    std::vector<float> invLeg1;   // 1 / (1 - split), 0 for straight paths
+
+    std::vector<float> startX, startY, startZ;
+    std::vector<float> midX, midY, midZ;
+    std::vector<float> endX, endY, endZ;
+    std::vector<float> posX, posY, posZ;
+
+    int size() const { return (int)t.size(); }
+
+    void clear();
+    void reserve(int n);
+    void push(const Actor& a);
+    void move(int dst, int src);
+    void resize(int n);
+
+    glm::vec3 position(int i) const { return glm::vec3(posX[i], posY[i], posZ[i]); }
+};
+
+// Advances t by dt * invDuration and recomputes positions for [begin, end).
+// All kernels do the same float operations in the same order, so they give
+// identical results; AnimKernelBest() picks the widest one the CPU runs.
+void AdvanceActorPaths(ActorPaths& p, int begin, int end, float dt, AnimKernel kernel);
+void AdvanceActorPaths(ActorPaths& p, float dt);
+
+AnimKernel AnimKernelBest();
+bool AnimKernelSupported(AnimKernel kernel);
+const char* AnimKernelName(AnimKernel kernel);
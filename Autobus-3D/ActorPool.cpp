@@ -0,0 +1,125 @@
+#include "ActorPool.h"
+
+ActorHandle ActorPool::insert(const Actor& a)
+{
+    int32_t idx;
+    if (freeHead >= 0)
+    {
+        idx = freeHead;
+        freeHead = slots[idx].nextFree;
+    }
+    else
+    {
+        idx = (int32_t)slots.size();
+        slots.emplace_back();
+    }
+
+    Slot& slot = slots[idx];
+    slot.actor = a;
+    slot.alive = true;
+    slot.nextFree = -1;
+
+    link(idx);
+    alive++;
+
+    ActorHandle h;
+    h.index = (uint32_t)idx;
+    h.generation = slot.generation;
+    return h;
+}
+
+bool ActorPool::erase(ActorHandle h)
+{
+    if (!get(h)) return false;
+
+    int32_t idx = (int32_t)h.index;
+    unlink(idx);
+
+    Slot& slot = slots[idx];
+    slot.alive = false;
+    slot.generation++;
+    slot.nextFree = freeHead;
+    freeHead = idx;
+
+    alive--;
+    return true;
+}
+
+// Slots are kept so handles from before the clear stay invalid; the free
+// list hands them out lowest index first, like a fresh pool.
+void ActorPool::clear()
+{
+    freeHead = -1;
+    for (int32_t idx = (int32_t)slots.size() - 1; idx >= 0; idx--)
+    {
+        Slot& slot = slots[idx];
+        if (slot.alive) slot.generation++;
+
+        slot.alive = false;
+        slot.prevOfType = -1;
+        slot.nextOfType = -1;
+        slot.nextFree = freeHead;
+        freeHead = idx;
+    }
+
+    alive = 0;
+    for (TypeList& l : lists) l = TypeList{};
+}
+
+Actor* ActorPool::get(ActorHandle h)
+{
+    if (h.index >= slots.size()) return nullptr;
+    Slot& slot = slots[h.index];
+    if (!slot.alive || slot.generation != h.generation) return nullptr;
+    return &slot.actor;
+}
+
+const Actor* ActorPool::get(ActorHandle h) const
+{
+    if (h.index >= slots.size()) return nullptr;
+    const Slot& slot = slots[h.index];
+    if (!slot.alive || slot.generation != h.generation) return nullptr;
+    return &slot.actor;
+}
+
+ActorHandle ActorPool::oldest(ActorType type) const
+{
+    ActorHandle h;
+    int32_t idx = lists[(int)type].head;
+    if (idx < 0) return h;
+
+    h.index = (uint32_t)idx;
+    h.generation = slots[idx].generation;
+    return h;
+}
+
+void ActorPool::link(int32_t idx)
+{
+    Slot& slot = slots[idx];
+    TypeList& l = lists[(int)slot.actor.type];
+
+    slot.prevOfType = l.tail;
+    slot.nextOfType = -1;
+
+    if (l.tail >= 0) slots[l.tail].nextOfType = idx;
+    else l.head = idx;
+
+    l.tail = idx;
+    l.count++;
+}
+
+void ActorPool::unlink(int32_t idx)
+{
+    Slot& slot = slots[idx];
+    TypeList& l = lists[(int)slot.actor.type];
+
+    if (slot.prevOfType >= 0) slots[slot.prevOfType].nextOfType = slot.nextOfType;
+    else l.head = slot.nextOfType;
+
+    if (slot.nextOfType >= 0) slots[slot.nextOfType].prevOfType = slot.prevOfType;
+    else l.tail = slot.prevOfType;
+
+    slot.prevOfType = -1;
+    slot.nextOfType = -1;
+    l.count--;
+}
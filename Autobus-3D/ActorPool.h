@@ -0,0 +1,79 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "Actor.h"
+
+struct ActorHandle
+{
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool valid() const { return index != UINT32_MAX; }
+    bool operator==(const ActorHandle& o) const { return index == o.index && generation == o.generation; }
+    bool operator!=(const ActorHandle& o) const { return !(*this == o); }
+};
+
+// Generational slot map for actors. Slots are recycled through a free list,
+// so insert/erase never move other actors and a handle stays valid until its
+// own actor is erased. Live actors of each ActorType are also chained in
+// insertion order, which makes "oldest passenger" and "the inspector" O(1).
+class ActorPool
+{
+public:
+    ActorHandle insert(const Actor& a);
+    bool erase(ActorHandle h);
+    void clear();
+
+    Actor* get(ActorHandle h);
+    const Actor* get(ActorHandle h) const;
+
+    int size() const { return alive; }
+    bool empty() const { return alive == 0; }
+
+    int count(ActorType type) const { return lists[(int)type].count; }
+    ActorHandle oldest(ActorType type) const;
+
+    template <typename F>
+    void forEach(F&& f) const
+    {
+        for (const Slot& slot : slots)
+            if (slot.alive) f(slot.actor);
+    }
+
+    // Live actors of one type in insertion order.
+    template <typename F>
+    void forEachOldestFirst(ActorType type, F&& f) const
+    {
+        for (int32_t i = lists[(int)type].head; i >= 0; i = slots[i].nextOfType)
+            f(slots[i].actor);
+    }
+
+private:
+    static constexpr int TYPE_COUNT = 2;
+
+    struct Slot
+    {
+        Actor actor;
+        uint32_t generation = 0;
+        bool alive = false;
+
+        int32_t nextFree = -1;
+        int32_t prevOfType = -1;
+        int32_t nextOfType = -1;
+    };
+
+    struct TypeList
+    {
+        int32_t head = -1;
+        int32_t tail = -1;
+        int count = 0;
+    };
+
+    std::vector<Slot> slots;
+    int32_t freeHead = -1;
+    int alive = 0;
+    TypeList lists[TYPE_COUNT];
+
+    void link(int32_t idx);
+    void unlink(int32_t idx);
+};
@@ -0,0 +1,159 @@
+#include "ActorScript.h"
+#include <algorithm>
+#include <new>
+
+ScriptFramePool::~ScriptFramePool()
+{
+    for (char* c : chunks) ::operator delete(c);
+}
+
+void* ScriptFramePool::allocate(size_t bytes)
+{
+    live++;
+
+    size_t cls = (bytes + SIZE_STEP - 1) / SIZE_STEP;
+    if (cls == 0 || cls > (size_t)SIZE_CLASSES) return ::operator new(bytes);
+
+    FreeFrame*& head = freeList[cls - 1];
+    if (head)
+    {
+        FreeFrame* f = head;
+        head = f->next;
+        return f;
+    }
+
+    size_t size = cls * SIZE_STEP;
+    if (bumpLeft < size)
+    {
+        // The tail of the old chunk is left unused.
+        bump = static_cast<char*>(::operator new(CHUNK_BYTES));
+        chunks.push_back(bump);
+        bumpLeft = CHUNK_BYTES;
+    }
+
+    void* p = bump;
+    bump += size;
+    bumpLeft -= size;
+    return p;
+}
+
+void ScriptFramePool::release(void* p, size_t bytes)
+{
+    if (!p) return;
+    live--;
+
+    size_t cls = (bytes + SIZE_STEP - 1) / SIZE_STEP;
+    if (cls == 0 || cls > (size_t)SIZE_CLASSES)
+    {
+        ::operator delete(p);
+        return;
+    }
+
+    FreeFrame* f = static_cast<FreeFrame*>(p);
+    f->next = freeList[cls - 1];
+    freeList[cls - 1] = f;
+}
+
+ScriptFramePool& ScriptFrames()
+{
+    static thread_local ScriptFramePool pool;
+    return pool;
+}
+
+ActorTask::promise_type::~promise_type()
+{
+    if (owner) owner->forget(slot);
+}
+
+static bool LaterTimer(double atA, uint64_t orderA, double atB, uint64_t orderB)
+{
+    if (atA != atB) return atA > atB;
+    return orderA > orderB;
+}
+
+void ActorScheduler::spawn(ActorTask task)
+{
+    std::coroutine_handle<ActorTask::promise_type> h = task.handle;
+    if (!h) return;
+    task.handle = nullptr;
+
+    h.promise().owner = this;
+    h.promise().slot = (uint32_t)live.size();
+    live.push_back(h);
+
+    wakeAt(time, h);
+}
+
+void ActorScheduler::wakeAt(double at, std::coroutine_handle<> h)
+{
+    timers.push_back(Timer{ at, nextOrder++, h });
+    std::push_heap(timers.begin(), timers.end(), [](const Timer& a, const Timer& b)
+        {
+            return LaterTimer(a.at, a.order, b.at, b.order);
+        });
+}
+
+void ActorScheduler::advance(double now)
+{
+    auto later = [](const Timer& a, const Timer& b) { return LaterTimer(a.at, a.order, b.at, b.order); };
+
+    while (!timers.empty() && timers.front().at <= now)
+    {
+        std::pop_heap(timers.begin(), timers.end(), later);
+        Timer t = timers.back();
+        timers.pop_back();
+
+        time = std::max(time, t.at);
+        resumes++;
+        t.handle.resume();
+    }
+
+    time = std::max(time, now);
+}
+
+void ActorScheduler::clear()
+{
+    std::vector<std::coroutine_handle<ActorTask::promise_type>> all;
+    all.swap(live);
+
+    for (auto h : all)
+    {
+        h.promise().owner = nullptr;
+        h.destroy();
+    }
+    timers.clear();
+}
+
+// Swap-remove; the script moved into the hole learns its new slot.
+void ActorScheduler::forget(uint32_t slot)
+{
+    live[slot] = live.back();
+    live[slot].promise().slot = slot;
+    live.pop_back();
+}
+
+bool ScriptQueue::Enter::await_ready() noexcept
+{
+    if (queue.busy) return false;
+    queue.busy = true;
+    return true;
+}
+
+void ScriptQueue::leave()
+{
+    if (waiters.empty())
+    {
+        busy = false;
+        return;
+    }
+
+    std::coroutine_handle<> next = waiters.front();
+    waiters.pop_front();
+    scheduler->wakeAt(scheduler->now(), next);
+}
+
+void ScriptQueue::reset()
+{
+    waiters.clear();
+    busy = false;
+}
@@ -0,0 +1,167 @@
+#pragma once
+#include <coroutine>
+#include <exception>
+#include <vector>
+#include <deque>
+#include <cstddef>
+#include <cstdint>
+
+// Free lists of coroutine frames in 64-byte size classes, carved out of
+// large chunks. Frames that finish go back on their list, so a steady
+// stream of scripts stops touching the heap once the pool has grown.
+// One pool per thread; a script must end on the thread that started it.
+class ScriptFramePool
+{
+public:
+    static constexpr size_t SIZE_STEP = 64;
+    static constexpr int SIZE_CLASSES = 16;   // larger frames go to the heap
+    static constexpr size_t CHUNK_BYTES = 64 * 1024;
+
+    ScriptFramePool() = default;
+    ScriptFramePool(const ScriptFramePool&) = delete;
+    ScriptFramePool& operator=(const ScriptFramePool&) = delete;
+    ~ScriptFramePool();
+
+    void* allocate(size_t bytes);
+    void release(void* p, size_t bytes);
+
+    size_t liveFrames() const { return live; }
+    size_t chunkCount() const { return chunks.size(); }
+    size_t reservedBytes() const { return chunks.size() * CHUNK_BYTES; }
+
+private:
+    struct FreeFrame { FreeFrame* next; };
+
+    FreeFrame* freeList[SIZE_CLASSES] = {};
+    std::vector<char*> chunks;
+    char* bump = nullptr;
+    size_t bumpLeft = 0;
+    size_t live = 0;
+};
+
+ScriptFramePool& ScriptFrames();
+
+class ActorScheduler;
+
+// Return type of an actor script. A script does nothing until it is handed
+// to ActorScheduler::spawn(); from then on the scheduler owns it.
+class ActorTask
+{
+public:
+    struct promise_type
+    {
+        ActorScheduler* owner = nullptr;
+        uint32_t slot = 0;
+
+        ActorTask get_return_object() { return ActorTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+
+        ~promise_type();
+
+        static void* operator new(size_t bytes) { return ScriptFrames().allocate(bytes); }
+        static void operator delete(void* p, size_t bytes) { ScriptFrames().release(p, bytes); }
+    };
+
+    ActorTask(ActorTask&& o) noexcept : handle(o.handle) { o.handle = nullptr; }
+    ActorTask(const ActorTask&) = delete;
+    ActorTask& operator=(const ActorTask&) = delete;
+    ~ActorTask() { if (handle) handle.destroy(); }
+
+private:
+    friend class ActorScheduler;
+    explicit ActorTask(std::coroutine_handle<promise_type> h) : handle(h) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+// Resumes suspended scripts when the sim clock reaches their wake time.
+// Scripts due in the same advance() run in (wake time, order of suspension)
+// order and see now() equal to their own wake time, so a script's timing
+// does not depend on the step size.
+class ActorScheduler
+{
+public:
+    ActorScheduler() = default;
+    ActorScheduler(const ActorScheduler&) = delete;
+    ActorScheduler& operator=(const ActorScheduler&) = delete;
+    ~ActorScheduler() { clear(); }
+
+    // The script starts on the next advance(), at the current time.
+    void spawn(ActorTask task);
+
+    void advance(double now);
+
+    // Destroys every unfinished script. Queues holding some of them have to
+    // be reset as well.
+    void clear();
+
+    double now() const { return time; }
+    size_t liveCount() const { return live.size(); }
+    size_t pendingWakeups() const { return timers.size(); }
+    uint64_t resumeCount() const { return resumes; }
+
+    void wakeAt(double at, std::coroutine_handle<> h);
+
+    struct Sleep
+    {
+        ActorScheduler& scheduler;
+        double seconds;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) { scheduler.wakeAt(scheduler.time + seconds, h); }
+        void await_resume() const noexcept {}
+    };
+
+    Sleep sleep(double seconds) { return Sleep{ *this, seconds }; }
+
+private:
+    friend struct ActorTask::promise_type;
+
+    struct Timer
+    {
+        double at;
+        uint64_t order;
+        std::coroutine_handle<> handle;
+    };
+
+    std::vector<Timer> timers;   // min-heap on (at, order)
+    std::vector<std::coroutine_handle<ActorTask::promise_type>> live;
+
+    double time = 0.0;
+    uint64_t nextOrder = 0;
+    uint64_t resumes = 0;
+
+    void forget(uint32_t slot);
+};
+
+// Lets one script at a time through (a door, a ticket validator), in the
+// order they asked. The next one in line wakes at the time the previous
+// one leaves.
+class ScriptQueue
+{
+public:
+    explicit ScriptQueue(ActorScheduler& s) : scheduler(&s) {}
+
+    struct Enter
+    {
+        ScriptQueue& queue;
+
+        bool await_ready() noexcept;
+        void await_suspend(std::coroutine_handle<> h) { queue.waiters.push_back(h); }
+        void await_resume() const noexcept {}
+    };
+
+    Enter enter() { return Enter{ *this }; }
+    void leave();
+    void reset();
+
+    size_t waiting() const { return waiters.size(); }
+
+private:
+    ActorScheduler* scheduler;
+    std::deque<std::coroutine_handle<>> waiters;
+    bool busy = false;
+};
@@ -0,0 +1,299 @@
+#include "AgentStore.h"
+#include "PassengerDemand.h"
+#include "SimRandom.h"
+#include <cmath>
+#include <algorithm>
+#include <thread>
+
+// Arrivals are drawn per origin stop in slots of this length, so the
+// hourly demand profile is followed exactly.
+static constexpr double AGENT_SLOT_SECONDS = 3600.0;
+
+// Below this many visits per worker a batch is done on the calling thread.
+static constexpr size_t AGENT_MIN_VISITS_PER_THREAD = 64;
+
+void AgentTotals::add(const AgentTotals& o)
+{
+    boarded += o.boarded;
+    alighted += o.alighted;
+    transfers += o.transfers;
+    denied += o.denied;
+    arrived += o.arrived;
+    journeySeconds += o.journeySeconds;
+}
+
+template <typename F>
+static void ParallelFor(int count, int threads, F&& body)
+{
+    threads = std::max(1, std::min(threads, count));
+    if (threads == 1)
+    {
+        for (int i = 0; i < count; i++) body(i);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for (int t = 0; t < threads; t++)
+    {
+        int begin = count * t / threads;
+        int end = count * (t + 1) / threads;
+        workers.emplace_back([&body, begin, end]()
+            {
+                for (int i = begin; i < end; i++) body(i);
+            });
+    }
+    for (auto& w : workers) w.join();
+}
+
+// A journey either rides one line straight to `dest` or changes to another
+// line at a stop strictly between the two.
+static void PlanJourney(Agent& a, int origin, int dest, int stops, int lines, int transferPercent, uint64_t r)
+{
+    int hops = (dest - origin + stops) % stops;
+    if (hops == 0) hops = stops;
+
+    a.stops[0] = (uint16_t)origin;
+    a.lines[0] = (uint8_t)SimRandomBelow((uint32_t)r, lines);
+
+    bool transfer = lines > 1 && hops >= 2 && SimRandomBelow((uint32_t)(r >> 32), 100) < transferPercent;
+    if (!transfer)
+    {
+        a.stops[1] = (uint16_t)dest;
+        a.legCount = 1;
+        return;
+    }
+
+    uint64_t r2 = SimMix64(r);
+    int via = (origin + 1 + SimRandomBelow((uint32_t)r2, hops - 1)) % stops;
+
+    a.stops[1] = (uint16_t)via;
+    a.stops[2] = (uint16_t)dest;
+    a.lines[1] = (uint8_t)((a.lines[0] + 1 + SimRandomBelow((uint32_t)(r2 >> 32), lines - 1)) % lines);
+    a.legCount = 2;
+}
+
+void AgentStore::generate(const PassengerDemand& demand, double t0, double t1,
+    const AgentPlanConfig& plan, uint64_t seed, int threads)
+{
+    const int stops = demand.stopCount();
+    lineCount = std::max(1, std::min(plan.lineCount, 256));
+    const int transferPercent = plan.transferPercent;
+
+    std::vector<std::vector<Agent>> perStop(stops);
+
+    ParallelFor(stops, threads, [&](int s)
+        {
+            std::vector<Agent>& out = perStop[s];
+
+            int64_t first = (int64_t)std::floor(t0 / AGENT_SLOT_SECONDS);
+            int64_t last = (int64_t)std::ceil(t1 / AGENT_SLOT_SECONDS);
+            for (int64_t slot = first; slot < last; slot++)
+            {
+                double a = std::max(t0, slot * AGENT_SLOT_SECONDS);
+                double b = std::min(t1, (slot + 1) * AGENT_SLOT_SECONDS);
+                if (b <= a) continue;
+
+                uint64_t key = SimMix64(seed ^ SimMix64(((uint64_t)(uint32_t)s << 40) ^ (uint64_t)slot));
+                int n = demand.sampleArrivals(s, a, b, key);
+
+                for (int k = 0; k < n; k++)
+                {
+                    uint64_t r = SimMix64(key ^ ((uint64_t)(k + 1) * 0xd1b54a32d192ed03ull));
+
+                    Agent ag;
+                    ag.departTime = (float)(a + (b - a) * ((double)(r >> 11) * (1.0 / 9007199254740992.0)));
+                    int dest = demand.sampleDestination(s, SimMix64(r));
+                    PlanJourney(ag, s, dest, stops, lineCount, transferPercent, SimMix64(r ^ 0x632be59bd9b4e019ull));
+                    out.push_back(ag);
+                }
+            }
+
+            std::stable_sort(out.begin(), out.end(),
+                [](const Agent& x, const Agent& y) { return x.departTime < y.departTime; });
+        });
+
+    originStart.assign(stops + 1, 0);
+    for (int s = 0; s < stops; s++)
+        originStart[s + 1] = originStart[s] + (uint32_t)perStop[s].size();
+
+    agents.clear();
+    agents.shrink_to_fit();
+    agents.reserve(originStart[stops]);
+    for (int s = 0; s < stops; s++)
+    {
+        agents.insert(agents.end(), perStop[s].begin(), perStop[s].end());
+        std::vector<Agent>().swap(perStop[s]);
+    }
+
+    nextToAppear.assign(originStart.begin(), originStart.end() - 1);
+    waiting.assign((size_t)stops * lineCount, std::deque<uint32_t>());
+    for (auto& list : riders) list.clear();
+    sums = AgentTotals{};
+}
+
+void AgentStore::setBusCount(int buses)
+{
+    riders.assign(std::max(0, buses), std::vector<uint32_t>());
+}
+
+size_t AgentStore::waitingAt(int stop) const
+{
+    size_t n = 0;
+    for (int l = 0; l < lineCount; l++) n += waiting[(size_t)stop * lineCount + l].size();
+    return n;
+}
+
+size_t AgentStore::notYetDeparted() const
+{
+    size_t n = 0;
+    for (size_t s = 0; s < nextToAppear.size(); s++) n += originStart[s + 1] - nextToAppear[s];
+    return n;
+}
+
+double AgentStore::bytesPerAgent() const
+{
+    if (agents.empty()) return 0.0;
+
+    size_t bytes = agents.capacity() * sizeof(Agent)
+        + (originStart.capacity() + nextToAppear.capacity()) * sizeof(uint32_t);
+    for (const auto& q : waiting) bytes += q.size() * sizeof(uint32_t);
+    for (const auto& list : riders) bytes += list.capacity() * sizeof(uint32_t);
+    return (double)bytes / (double)agents.size();
+}
+
+void AgentStore::visitStop(StopVisit& v)
+{
+    std::vector<uint32_t> transfers;
+    visit(v, transfers, sums);
+}
+
+void AgentStore::visit(StopVisit& v, std::vector<uint32_t>& transfers, AgentTotals& t)
+{
+    v.alighted = v.boarded = v.denied = 0;
+    if (v.stop >= stopCount() || v.bus >= riders.size()) return;
+
+    // Agents whose departure time has come join their first line's queue.
+    uint32_t& next = nextToAppear[v.stop];
+    const uint32_t end = originStart[v.stop + 1];
+    while (next < end && (double)agents[next].departTime <= v.time)
+    {
+        Agent& a = agents[next];
+        a.state = AgentState::Waiting;
+        waiting[(size_t)v.stop * lineCount + a.lines[0]].push_back(next);
+        next++;
+    }
+
+    std::vector<uint32_t>& onBoard = riders[v.bus];
+    transfers.clear();
+
+    size_t keep = 0;
+    for (uint32_t id : onBoard)
+    {
+        Agent& a = agents[id];
+        if (a.stops[a.leg + 1] != v.stop)
+        {
+            onBoard[keep++] = id;
+            continue;
+        }
+
+        v.alighted++;
+        a.leg++;
+        a.bus = AGENT_NO_BUS;
+
+        if (a.leg >= a.legCount)
+        {
+            a.state = AgentState::Arrived;
+            a.arriveTime = (float)v.time;
+            t.arrived++;
+            t.journeySeconds += v.time - (double)a.departTime;
+        }
+        else
+        {
+            a.state = AgentState::Waiting;
+            transfers.push_back(id);
+            t.transfers++;
+        }
+    }
+    onBoard.resize(keep);
+
+    if (v.line < lineCount)
+    {
+        std::deque<uint32_t>& queue = waiting[(size_t)v.stop * lineCount + v.line];
+        int room = v.room + v.alighted;
+        while (room > 0 && !queue.empty())
+        {
+            uint32_t id = queue.front();
+            queue.pop_front();
+
+            Agent& a = agents[id];
+            a.state = AgentState::Riding;
+            a.bus = v.bus;
+            onBoard.push_back(id);
+            v.boarded++;
+            room--;
+        }
+        v.denied = (int32_t)queue.size();
+    }
+
+    // Riders who changed here wait for a later bus of their next line.
+    for (uint32_t id : transfers)
+    {
+        const Agent& a = agents[id];
+        waiting[(size_t)v.stop * lineCount + a.lines[a.leg]].push_back(id);
+    }
+
+    t.boarded += v.boarded;
+    t.alighted += v.alighted;
+    t.denied += v.denied;
+}
+
+int ForEachStopRun(std::vector<StopVisit>& visits, int threads,
+    const std::function<void(size_t, size_t, int)>& body)
+{
+    if (visits.empty()) return 0;
+
+    std::sort(visits.begin(), visits.end(), [](const StopVisit& a, const StopVisit& b)
+        {
+            if (a.stop != b.stop) return a.stop < b.stop;
+            if (a.time != b.time) return a.time < b.time;
+            return a.bus < b.bus;
+        });
+
+    std::vector<size_t> groupStart;
+    for (size_t i = 0; i < visits.size(); i++)
+        if (i == 0 || visits[i].stop != visits[i - 1].stop) groupStart.push_back(i);
+    groupStart.push_back(visits.size());
+
+    int groups = (int)groupStart.size() - 1;
+    int maxThreads = (int)std::max<size_t>(1, visits.size() / AGENT_MIN_VISITS_PER_THREAD);
+    threads = std::max(1, std::min(threads, std::min(groups, maxThreads)));
+
+    // Workers take contiguous runs of whole stops, about the same number of
+    // visits each.
+    auto groupAt = [&](size_t visit)
+        {
+            return (int)(std::lower_bound(groupStart.begin(), groupStart.end(), visit) - groupStart.begin());
+        };
+
+    ParallelFor(threads, threads, [&](int t)
+        {
+            int g0 = groupAt(visits.size() * t / threads);
+            int g1 = groupAt(visits.size() * (t + 1) / threads);
+            body(groupStart[g0], groupStart[g1], t);
+        });
+    return threads;
+}
+
+void AgentStore::processVisits(std::vector<StopVisit>& visits, int threads)
+{
+    std::vector<AgentTotals> partial(std::max(1, threads));
+    int used = ForEachStopRun(visits, threads, [&](size_t first, size_t last, int t)
+        {
+            std::vector<uint32_t> transfers;
+            for (size_t i = first; i < last; i++)
+                visit(visits[i], transfers, partial[t]);
+        });
+
+    for (int t = 0; t < used; t++) sums.add(partial[t]);
+}
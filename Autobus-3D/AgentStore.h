@@ -0,0 +1,130 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+class PassengerDemand;
+
+constexpr int AGENT_MAX_LEGS = 2;   // PlanJourney makes at most one transfer
+constexpr uint32_t AGENT_NO_BUS = 0xFFFFFFFFu;
+
+enum class AgentState : uint8_t { Planned, Waiting, Riding, Arrived };
+
+// One traveller. Leg i rides a bus of lines[i] from stops[i] to stops[i + 1];
+// a transfer happens at the stop where the previous leg ended.
+struct Agent
+{
+    float departTime = 0.0f;       // sim time it shows up at stops[0]
+    float arriveTime = 0.0f;       // sim time its last leg ended
+    uint32_t bus = AGENT_NO_BUS;   // while riding
+    uint16_t stops[AGENT_MAX_LEGS + 1] = {};
+    uint8_t lines[AGENT_MAX_LEGS] = {};
+    uint8_t legCount = 1;
+    uint8_t leg = 0;
+    AgentState state = AgentState::Planned;
+};
+
+static_assert(sizeof(Agent) <= 32, "agents must stay small enough to keep millions in memory");
+
+struct AgentPlanConfig
+{
+    // Lines are services sharing the route; a fleet bus runs line
+    // bus % lineCount. Transfers need at least two lines.
+    int lineCount = 1;
+    int transferPercent = 0;   // share of journeys that change line on the way
+};
+
+// One bus standing at one stop. The caller fills in the first block, the
+// store the results.
+struct StopVisit
+{
+    double time = 0.0;
+    uint32_t bus = 0;
+    uint16_t stop = 0;
+    uint8_t line = 0;
+    int32_t room = 0;   // free places when the bus pulled in
+    uint64_t key = 0;   // random draws of the visit (demand model only)
+
+    int32_t alighted = 0;
+    int32_t boarded = 0;
+    int32_t denied = 0;   // riders for this line left at the stop, bus full
+};
+
+// Sorts a batch of visits by (stop, time, bus) and calls body(first, last,
+// worker) for runs of whole stops, one run per worker thread. A visit that
+// only touches its own stop and its own bus is then race-free, and the
+// order within a stop does not depend on the thread count. Returns the
+// number of workers used.
+int ForEachStopRun(std::vector<StopVisit>& visits, int threads,
+    const std::function<void(size_t, size_t, int)>& body);
+
+struct AgentTotals
+{
+    long long boarded = 0;
+    long long alighted = 0;
+    long long transfers = 0;
+    long long denied = 0;
+    long long arrived = 0;
+    double journeySeconds = 0.0;   // summed over arrived agents
+
+    void add(const AgentTotals& o);
+};
+
+// Individual riders on top of the buses' stop visits. Agents are stored
+// grouped by origin stop and sorted by departure time within a group, so
+// making them appear at their stop is a cursor walk; waiting and riding
+// agents are referenced by index from per-(stop, line) queues and per-bus
+// lists.
+//
+// A stop visit only touches its own stop's queue and its own bus's riders
+// (transfers wait at the stop they got off at), so visits at different
+// stops can run in parallel.
+class AgentStore
+{
+public:
+    // Draws every journey starting in [t0, t1) from the demand model's
+    // arrival rates and O/D tables. Each origin stop is generated from its
+    // own random stream, so the result does not depend on `threads`.
+    void generate(const PassengerDemand& demand, double t0, double t1,
+        const AgentPlanConfig& plan, uint64_t seed, int threads);
+
+    void setBusCount(int buses);
+
+    // Riders whose leg ends here get off, then riders waiting for the bus's
+    // line get on while there is room.
+    void visitStop(StopVisit& v);
+
+    // A batch of visits with at most one per bus. Visits are grouped by
+    // stop and done in (time, bus) order within a stop; stops are shared
+    // out over `threads`. Results do not depend on the thread count.
+    void processVisits(std::vector<StopVisit>& visits, int threads);
+
+    size_t size() const { return agents.size(); }
+    const Agent& agent(size_t i) const { return agents[i]; }
+    int stopCount() const { return (int)nextToAppear.size(); }
+    int lines() const { return lineCount; }
+
+    size_t waitingAt(int stop) const;
+    size_t ridingOn(int bus) const { return riders[bus].size(); }
+    size_t notYetDeparted() const;
+
+    const AgentTotals& totals() const { return sums; }
+
+    // Bytes held per agent, lists included.
+    double bytesPerAgent() const;
+
+private:
+    std::vector<Agent> agents;
+    std::vector<uint32_t> originStart;    // stopCount + 1 offsets into `agents`
+    std::vector<uint32_t> nextToAppear;   // per stop, first agent still Planned
+
+    int lineCount = 1;
+    std::vector<std::deque<uint32_t>> waiting;    // stop * lineCount + line, first come first served
+    std::vector<std::vector<uint32_t>> riders;    // per bus
+
+    AgentTotals sums;
+
+    void visit(StopVisit& v, std::vector<uint32_t>& transfers, AgentTotals& t);
+};
@@ -0,0 +1,88 @@
+#include "BoardingScript.h"
+#include "BusLogic.h"
+#include "SimRandom.h"
+
+// Each leg of BusLogic's door path (outside -> threshold, threshold -> seat).
+static constexpr float DOOR_LEG_TIME = PASSENGER_MOVE_TIME * 0.5f;
+
+static constexpr double TICKET_CHECK_TIME = 1.2;
+static constexpr int TICKET_FAIL_PERCENT = 3;
+
+ScriptedStop::ScriptedStop(ActorScheduler& s, const BusGeometry& g)
+    : scheduler(s), geometry(g), door(s), validator(s)
+{
+    reset();
+}
+
+void ScriptedStop::reset()
+{
+    door.reset();
+    validator.reset();
+    seats.reset(geometry.seats.count());
+    riders.clear();
+    seated = standing = refused = 0;
+}
+
+static void StartWalk(Actor& a, const glm::vec3& to, float duration)
+{
+    a.startPos = a.pos;
+    a.endPos = to;
+    a.useMid = false;
+    a.t = 0.0f;
+    a.duration = duration;
+}
+
+ActorTask BoardingSequence(ScriptedStop& stop, int rider, uint64_t key)
+{
+    const BusGeometry& g = stop.geometry;
+    {
+        Actor& a = stop.riders[rider];
+        a.anim = ActorAnim::None;
+        a.pos = g.doorOutside;
+    }
+
+    // The next rider may start through the door DOOR_SPACING later, as in
+    // BusLogic's door queue.
+    co_await stop.door.enter();
+    StartWalk(stop.riders[rider], g.doorThreshold, DOOR_LEG_TIME);
+    stop.riders[rider].anim = ActorAnim::Entering;
+    co_await stop.scheduler.sleep(DOOR_SPACING);
+    stop.door.leave();
+    co_await stop.scheduler.sleep(DOOR_LEG_TIME - DOOR_SPACING);
+    stop.riders[rider].pos = g.doorThreshold;
+
+    co_await stop.validator.enter();
+    co_await stop.scheduler.sleep(TICKET_CHECK_TIME);
+    stop.validator.leave();
+
+    if (SimRandomBelow((uint32_t)key, 100) < TICKET_FAIL_PERCENT)
+    {
+        co_await stop.door.enter();
+        StartWalk(stop.riders[rider], g.doorOutside, DOOR_LEG_TIME);
+        stop.riders[rider].anim = ActorAnim::Exiting;
+        co_await stop.scheduler.sleep(DOOR_SPACING);
+        stop.door.leave();
+        co_await stop.scheduler.sleep(DOOR_LEG_TIME - DOOR_SPACING);
+
+        Actor& a = stop.riders[rider];
+        a.pos = g.doorOutside;
+        a.anim = ActorAnim::None;
+        stop.refused++;
+        co_return;
+    }
+
+    int seat = stop.seats.acquire();
+    glm::vec3 target = (seat >= 0) ? g.seats.seat(seat).pos : g.insideSpot;
+
+    Actor& a = stop.riders[rider];
+    a.seat = seat;
+    StartWalk(a, target, DOOR_LEG_TIME);
+    co_await stop.scheduler.sleep(DOOR_LEG_TIME);
+
+    Actor& done = stop.riders[rider];
+    done.pos = target;
+    done.t = 1.0f;
+    done.anim = ActorAnim::Inside;
+    if (seat >= 0 && !g.seats.seat(seat).standing) stop.seated++;
+    else stop.standing++;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "Actor.h"
+#include "ActorScript.h"
+#include "BusGeometry.h"
+#include "SeatLayout.h"
+
+// One bus standing at a stop with its door and ticket validator, boarded by
+// scripted riders. Each rider is one BoardingSequence() instead of a set of
+// door flags and timers, so a new step is a few more lines of script.
+//
+// A standalone demo of the script runtime (Headless --script-bench); the
+// app and the sims still board through BusLogic. Door timings are
+// BusLogic's, the ticket check is the one step it does not have.
+struct ScriptedStop
+{
+    ScriptedStop(ActorScheduler& s, const BusGeometry& g);
+
+    // Ready for another wave of riders; their scripts must be gone.
+    void reset();
+
+    ActorScheduler& scheduler;
+    const BusGeometry& geometry;
+
+    ScriptQueue door;        // one rider through the door at a time
+    ScriptQueue validator;
+    SeatAllocator seats;
+
+    std::vector<Actor> riders;
+
+    int seated = 0;
+    int standing = 0;
+    int refused = 0;   // ticket did not validate, stepped back off
+};
+
+// Queue at the door, step in, validate the ticket, find a seat (or a place
+// to stand) and walk there. `key` draws the ticket check.
+ActorTask BoardingSequence(ScriptedStop& stop, int rider, uint64_t key);
@@ -0,0 +1,97 @@
+#include "BusGeometry.h"
+#include <glm/gtc/matrix_transform.hpp>
+
+// Riders walk this far above the floor, and wait this far outside the door.
+static constexpr float RIDER_HEIGHT = 0.25f;
+static constexpr float DOOR_WAIT_DISTANCE = 0.55f;
+static constexpr float DOOR_THRESHOLD_INSET = 0.05f;
+
+// Windscreen frame and glass, relative to the front end of the body.
+static constexpr float WINDSCREEN_LIFT = 0.05f;
+static constexpr float WINDSCREEN_FRAME_MARGIN = 0.03f;   // body height minus frame height
+static constexpr float WINDSCREEN_FRAME_DEPTH = 0.08f;
+static constexpr float WINDSCREEN_GLASS_MARGIN = 0.10f;   // frame size minus glass size
+static constexpr float WINDSCREEN_GLASS_INSET = 0.05f;
+static constexpr float WINDSCREEN_GLASS_DEPTH = 0.03f;
+
+// The cabin light hangs just under the roof, this far back from the front.
+static constexpr float LAMP_DROP = 0.04f;
+static constexpr float LAMP_BACK = 1.70f;
+
+static BusBox MakeBox(const glm::vec3& center, const glm::vec3& size, BusPart part)
+{
+    BusBox b;
+    b.center = center;
+    b.size = size;
+    b.part = part;
+    b.transform = glm::scale(glm::translate(glm::mat4(1.0f), center), size);
+    return b;
+}
+
+BusGeometry BuildBusGeometry(const BusType& type)
+{
+    BusGeometry g;
+    g.type = type;
+
+    const float w = type.width;
+    const float h = type.height;
+    const float len = type.length;
+    g.center = glm::vec3(type.center[0], type.center[1], type.center[2]);
+
+    float floorTop = (g.center.y - h * 0.5f) + type.floorThickness * 0.5f;
+    g.riderY = floorTop + RIDER_HEIGHT;
+
+    const float zFront = -len * 0.5f;
+    const float zBack = +len * 0.5f;
+    g.doorZ0 = zFront;
+    g.doorZ1 = zFront + type.doorLength;
+    const float zMid = 0.5f * (g.doorZ0 + g.doorZ1);
+
+    const float wallX = g.center.x + w * 0.5f;
+    g.doorOutside = glm::vec3(wallX + DOOR_WAIT_DISTANCE, g.riderY, g.center.z + zMid);
+    g.doorThreshold = glm::vec3(wallX - DOOR_THRESHOLD_INSET, g.riderY, g.center.z + zMid);
+    g.insideSpot = glm::vec3(g.center.x + 0.20f, g.riderY, g.center.z + len * 0.20f);
+
+    g.shell.push_back(MakeBox(g.center + glm::vec3(0.0f, -h * 0.5f, 0.0f), glm::vec3(w, type.floorThickness, len), BusPart::Floor));
+    g.shell.push_back(MakeBox(g.center + glm::vec3(0.0f, +h * 0.5f, 0.0f), glm::vec3(w, type.floorThickness, len), BusPart::Roof));
+    g.shell.push_back(MakeBox(g.center + glm::vec3(-w * 0.5f, 0.0f, 0.0f), glm::vec3(type.wallThickness, h, len), BusPart::Wall));
+
+    // The right wall only runs behind the door.
+    if (zBack - g.doorZ1 > 0.001f)
+    {
+        g.shell.push_back(MakeBox(g.center + glm::vec3(+w * 0.5f, 0.0f, (g.doorZ1 + zBack) * 0.5f),
+            glm::vec3(type.wallThickness, h, zBack - g.doorZ1), BusPart::Wall));
+    }
+
+    g.doorCenterClosed = g.center + glm::vec3(+w * 0.5f - type.doorThickness * 0.5f, 0.0f, zMid);
+    g.doorHinge = g.center + glm::vec3(+w * 0.5f, 0.0f, g.doorZ0);
+    g.doorSize = glm::vec3(type.doorThickness, h, type.doorLength);
+
+    g.windscreenCenter = g.center + glm::vec3(0.0f, WINDSCREEN_LIFT, zFront);
+    g.windscreenSize = glm::vec3(w, h - WINDSCREEN_FRAME_MARGIN, WINDSCREEN_FRAME_DEPTH);
+    g.glassCenter = g.windscreenCenter + glm::vec3(0.0f, 0.0f, WINDSCREEN_GLASS_INSET);
+    g.glassSize = glm::vec3(w - WINDSCREEN_GLASS_MARGIN, h - WINDSCREEN_GLASS_MARGIN, WINDSCREEN_GLASS_DEPTH);
+
+    g.lampPos = g.center + glm::vec3(0.0f, h * 0.5f - LAMP_DROP, zFront + LAMP_BACK);
+
+    glm::vec3 panelCenter(type.panelCenter[0], type.panelCenter[1], type.panelCenter[2]);
+    glm::vec3 panelSize(type.panelSize[0], type.panelSize[1], type.panelSize[2]);
+    glm::vec3 panelHinge = panelCenter + glm::vec3(0.0f, 0.5f * panelSize.y, -0.5f * panelSize.z);
+
+    glm::mat4 Panel(1.0f);
+    Panel = glm::translate(Panel, panelHinge);
+    Panel = glm::rotate(Panel, glm::radians(type.panelTiltDeg), glm::vec3(1, 0, 0));
+    Panel = glm::translate(Panel, -panelHinge);
+    Panel = glm::translate(Panel, panelCenter);
+    Panel = glm::scale(Panel, panelSize);
+    g.panelLocal = Panel;
+
+    g.seats.build(g.center, len, w, g.riderY, g.doorZ1);
+    return g;
+}
+
+const BusGeometry& StandardBusGeometry()
+{
+    static const BusGeometry geometry = BuildBusGeometry(STANDARD_BUS);
+    return geometry;
+}
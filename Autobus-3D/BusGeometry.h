@@ -0,0 +1,92 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include "SeatLayout.h"
+
+// Dimensions of one kind of bus, in bus-local units. A new bus type is a new
+// BusType; everything derived from it is built by BuildBusGeometry().
+struct BusType
+{
+    float center[3];
+    float width;
+    float height;
+    float length;
+
+    float floorThickness;
+    float wallThickness;
+
+    // The door sits in the right wall at the front, hinged at its front edge.
+    float doorLength;
+    float doorThickness;
+    float doorOpenDeg;
+
+    float panelCenter[3];
+    float panelSize[3];
+    float panelTiltDeg;
+};
+
+constexpr BusType STANDARD_BUS = {
+    { 0.0f, 1.10f, 2.30f }, 2.4f, 0.98f, 7.0f,
+    0.10f, 0.08f,
+    1.20f, 0.06f, 80.0f,
+    { -0.25f, 0.67f, -0.62f }, { 1.5f, 0.42f, 0.48f }, -12.0f,
+};
+
+enum class BusPart { Floor, Roof, Wall };
+
+struct BusBox
+{
+    glm::vec3 center;
+    glm::vec3 size;
+    BusPart part;
+    glm::mat4 transform;   // unit cube to bus-local box
+};
+
+// Layout of the dashboard face in its own 0..1 uv space.
+struct PanelFace
+{
+    glm::vec2 mapMin = glm::vec2(0.42f, 0.32f);
+    glm::vec2 mapMax = glm::vec2(0.97f, 0.93f);
+    float lift = 0.08f;   // everything is drawn this much higher up the face
+    float offset = 0.02f; // in front of the face, against z-fighting
+};
+
+// Everything BusLogic, BusRender and Hud2D need to know about the bus body,
+// computed once from a BusType.
+struct BusGeometry
+{
+    BusType type;
+
+    glm::vec3 center;
+    float riderY = 0.0f;   // height actors walk at
+
+    float doorZ0 = 0.0f;   // door z-range, relative to `center`
+    float doorZ1 = 0.0f;
+    glm::vec3 doorOutside;
+    glm::vec3 doorThreshold;
+    glm::vec3 insideSpot;  // where riders without a seat stand
+
+    std::vector<BusBox> shell;
+
+    glm::vec3 doorHinge;
+    glm::vec3 doorCenterClosed;
+    glm::vec3 doorSize;
+
+    // Windscreen across the front end: the outer size of its frame, and the
+    // glass just behind it.
+    glm::vec3 windscreenCenter;
+    glm::vec3 windscreenSize;
+    glm::vec3 glassCenter;
+    glm::vec3 glassSize;
+
+    glm::vec3 lampPos;   // cabin light under the roof
+
+    glm::mat4 panelLocal = glm::mat4(1.0f);
+    PanelFace panelFace;
+
+    SeatLayout seats;
+};
+
+BusGeometry BuildBusGeometry(const BusType& type);
+
+const BusGeometry& StandardBusGeometry();
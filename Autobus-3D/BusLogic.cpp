@@ -1,14 +1,17 @@
 ﻿#include "BusLogic.h"
 #include "RouteData.h"
 #include <cmath>
-#include <cstdlib>
 #include <algorithm>
 
-static float clamp01(float x) { return (x < 0.0f) ? 0.0f : (x > 1.0f ? 1.0f : x); }
-static float smooth01(float t) { t = clamp01(t); return t * t * (3.0f - 2.0f * t); }
+static constexpr int MOVING_RESERVE = 256;
 
-static constexpr float PASSENGER_MOVE_TIME = 1.6f;
-static constexpr float CONTROL_MOVE_TIME = 2.4f;
+// Demand-driven stop visits animate at most this many riders through the
+// door (so the queue fits in the dwell time); the rest appear or vanish.
+static constexpr int DEMAND_ANIMATED_MAX = 16;
+
+// Deadlines are pushed slightly past the exact crossing so a jump straight
+// to them always lands on the far side despite rounding.
+static constexpr double EVENT_EPSILON = 1e-5;
 
 BusLogic::BusLogic()
 {
@@ -33,38 +36,96 @@ void BusLogic::reset(double now)
 
     s.busPos = RoutePoint3D(0);
 
+    stopVisits = 0;
     nextId = 1;
     inside.clear();
-    movingActive = false;
-    moving = Actor{};
+    seats.reset(geometry->seats.count());
+    moving.clear();
+    moving.reserve(MOVING_RESERVE);
+    movingPaths.clear();
+    movingPaths.reserve(MOVING_RESERVE);
+
+    ridersTo.assign(demand ? demand->stopCount() : 0, 0);
+    lastStopVisit.assign(ridersTo.size(), now);
+    waitingAt.assign(ridersTo.size(), 0);
+    demandStats = DemandTotals{};
+    doorQueue = 0.0f;
 }
 
-void BusLogic::update(double now, double dt)
+void BusLogic::setRandomStream(uint64_t seed, uint32_t busId)
 {
-    updateMovingActor((float)dt);
+    rngSeed = seed;
+    rngStream = busId;
+}
 
-    if (s.atStop)
+void BusLogic::update(double now, double dt)
+{
+    // The step is used up piece by piece: the bus stops at every stop it
+    // crosses at the exact time it gets there and the rest of the step goes
+    // to the dwell and the next segments, so one large step ends in the same
+    // place as many small ones.
+    double t = now - dt;
+    double left = dt;
+
+    while (left > 0.0)
     {
-        s.doorState = DoorState::OPEN;
+        if (s.atStop)
+        {
+            double dwellLeft = std::max(0.0, s.stopStartTime + STOP_DWELL_TIME - t);
+            double piece = std::min(left, dwellLeft);
 
-        processDoorAction(dt);
+            updateMovingActors((float)piece);
+            processDoorAction(piece);
+            t += piece;
+            left -= piece;
 
-        if (now - s.stopStartTime >= 10.0)
+            if (dwellLeft > piece) break;
             leaveStop();
+            continue;
+        }
 
-        s.passengerCount = s.passengers;
-        return;
-    }
+        double toPoint = timeToNextPoint();
+        if (left < toPoint)
+        {
+            updateMovingActors((float)left);
+            moveAlongRoute((float)left);
+            break;
+        }
 
-    s.doorState = DoorState::CLOSED;
+        updateMovingActors((float)toPoint);
+        t += toPoint;
+        left -= toPoint;
 
-    bool reached = moveAlongRoute((float)dt);
-    if (reached && IsStopPoint(s.currentRoutePoint))
-        arriveToStop(now);
+        reachNextPoint();
+        if (IsStopPoint(s.currentRoutePoint))
+            arriveToStop(t);
+    }
 
+    s.doorState = s.atStop ? DoorState::OPEN : DoorState::CLOSED;
     s.passengerCount = s.passengers;
 }
 
+double BusLogic::nextEventTime(double now) const
+{
+    double next;
+
+    if (s.atStop)
+    {
+        next = s.stopStartTime + STOP_DWELL_TIME;
+        if (s.doorAction != DoorAction::NONE)
+            next = std::min(next, now + (double)s.doorActionTimer);
+    }
+    else
+    {
+        next = now + timeToNextPoint();
+    }
+
+    for (const Actor& a : moving)
+        next = std::min(next, now + (double)((1.0f - a.t) * std::max(0.001f, a.duration)));
+
+    return std::max(next, now) + EVENT_EPSILON;
+}
+
 void BusLogic::leaveStop()
 {
     s.atStop = false;
@@ -72,127 +133,205 @@ void BusLogic::leaveStop()
 
     s.doorAction = DoorAction::NONE;
     s.doorActionTimer = 0.0f;
+    doorQueue = 0.0f;
 }
 
 void BusLogic::arriveToStop(double now)
 {
     s.atStop = true;
     s.stopStartTime = now;
+    stopVisits++;
 
     if (s.controlInside)
     {
         controlExitAndFine();
 
-        if (!movingActive)
+        if (inside.count(ActorType::Control) > 0)
         {
             s.doorAction = DoorAction::EXITING;
-            s.doorActionTimer = CONTROL_MOVE_TIME;
-
-            startExitActor();
+            s.doorActionTimer = std::max(s.doorActionTimer, startExitActor());
         }
     }
+
+    if (demand) applyDemand(now);
 }
 
-bool BusLogic::moveAlongRoute(float dt)
+void BusLogic::setDemand(const PassengerDemand* model)
 {
-    int nextRoutePoint = (s.currentRoutePoint + 1) % ROUTE_POINT_COUNT;
+    demand = model;
+    ridersTo.assign(demand ? demand->stopCount() : 0, 0);
+    lastStopVisit.assign(ridersTo.size(), s.stopStartTime);
+    waitingAt.assign(ridersTo.size(), 0);
+}
 
-    glm::vec3 c = RoutePoint3D(s.currentRoutePoint);
-    glm::vec3 n = RoutePoint3D(nextRoutePoint);
+void BusLogic::applyDemand(double now)
+{
+    int stop = StopNumberForRouteIdx(s.currentRoutePoint);
+    if (stop < 0 || stop >= (int)ridersTo.size()) return;
 
-    float len = glm::length(n - c);
-    if (len < 1e-6f) len = 1e-6f;
+    uint64_t key = ((uint64_t)SimRandom(rngSeed, rngStream, stopVisits, RandomLane::Demand) << 32) ^ stopVisits;
+    StopDemandResult r = demand->visitStop(stop, lastStopVisit[stop], now,
+        BUS_CAPACITY - s.passengers, key, ridersTo.data(), waitingAt[stop]);
+    lastStopVisit[stop] = now;
 
-    float worldSpeed = 1.25f;
-    s.travelT += (worldSpeed / len) * dt;
+    // Riders who no longer fit keep waiting for the next visit.
+    StopDemandResult done = applyStopResult(r);
+    waitingAt[stop] += r.boarded - done.boarded;
+}
 
-    if (s.travelT >= 1.0f)
+// Returns the counts actually applied.
+StopDemandResult BusLogic::applyStopResult(StopDemandResult r)
+{
+    // Riders let off by hand earlier are no longer on board.
+    int control = s.controlInside ? 1 : 0;
+    r.alighted = std::min(r.alighted, std::max(0, s.passengers - control));
+    int room = BUS_CAPACITY - (s.passengers - r.alighted);
+    if (r.boarded > room)
     {
-        s.travelT = 0.0f;
-        s.currentRoutePoint = nextRoutePoint;
-        s.busPos = RoutePoint3D(s.currentRoutePoint);
-        return true;
+        r.denied += r.boarded - room;
+        r.boarded = room;
     }
 
-    s.busPos = c + (n - c) * s.travelT;
-    return false;
-}
+    s.passengers += r.boarded - r.alighted;
+    s.passengerCount = s.passengers;
+    demandStats.add(r);
 
-void BusLogic::processDoorAction(double dt)
-{
-    if (s.doorAction == DoorAction::NONE) return;
+    int animated = 0;
+    float doorTime = 0.0f;
 
-    s.doorActionTimer -= (float)dt;
-    if (s.doorActionTimer <= 0.0f)
+    for (int i = 0; i < r.alighted; i++)
     {
-        s.doorAction = DoorAction::NONE;
-        s.doorActionTimer = 0.0f;
-    }
-}
-
-glm::vec3 BusLogic::doorOutsidePos() const
-{
-    const float busWidth = 2.4f;
-    const float busLength = 7.0f;
-    const float busHeight = 0.98f;
+        ActorHandle h = inside.oldest(ActorType::Passenger);
+        if (!h.valid()) break;
 
-    glm::vec3 busCenter = glm::vec3(0.0f, 1.10f, 2.30f);
+        if (animated < DEMAND_ANIMATED_MAX)
+        {
+            doorTime = std::max(doorTime, startExitActor(h));
+            animated++;
+        }
+        else
+        {
+            if (Actor* a = inside.get(h)) freeSeat(*a);
+            inside.erase(h);
+        }
+    }
 
-    const float zFront = -busLength * 0.5f;
-    const float zDoor0 = zFront;
-    const float zDoor1 = zFront + 1.20f;
-    const float zMid = 0.5f * (zDoor0 + zDoor1);
+    for (int i = 0; i < r.boarded; i++)
+    {
+        if (animated < DEMAND_ANIMATED_MAX)
+        {
+            doorTime = std::max(doorTime, startEnterActor(ActorType::Passenger));
+            animated++;
+            continue;
+        }
 
-    float floorTopWorld = (busCenter.y - busHeight * 0.5f) + 0.10f * 0.5f;
-    float yWorld = floorTopWorld + 0.25f;
+        Actor a;
+        a.id = nextId++;
+        a.type = ActorType::Passenger;
+        a.modelIndex = (a.id - 1) % SKIN_COUNT;
+        a.anim = ActorAnim::Inside;
+        a.seat = seats.acquire();
+        a.pos = seatPos(a.seat);
+        inside.insert(a);
+    }
 
-    float wallX = busCenter.x + busWidth * 0.5f;
+    if (animated > 0)
+    {
+        s.doorAction = (r.boarded > 0) ? DoorAction::ENTERING : DoorAction::EXITING;
+        s.doorActionTimer = std::max(s.doorActionTimer, doorTime);
+    }
+    return r;
+}
 
-    float xWorld = wallX + 0.55f;
+void BusLogic::setGeometry(const BusGeometry& g)
+{
+    geometry = &g;
+    seats.reset(geometry->seats.count());
+}
 
-    return glm::vec3(xWorld, yWorld, busCenter.z + zMid);
+void BusLogic::setSmoothPath(bool enabled)
+{
+    smooth = enabled;
+    s.busPos = pathPosition(s.currentRoutePoint, s.travelT);
 }
 
-glm::vec3 BusLogic::doorThresholdPos() const
+float BusLogic::pathSegmentLength(int seg) const
 {
-    const float busWidth = 2.4f;
-    const float busLength = 7.0f;
-    const float busHeight = 0.98f;
+    return smooth ? RouteSpline().segmentLength(seg) : RouteArc().segmentLength(seg);
+}
 
-    glm::vec3 busCenter = glm::vec3(0.0f, 1.10f, 2.30f);
+glm::vec3 BusLogic::pathPosition(int seg, float t) const
+{
+    if (smooth) return RouteSpline().position(seg, t);
 
-    const float zFront = -busLength * 0.5f;
-    const float zDoor0 = zFront;
-    const float zDoor1 = zFront + 1.20f;
-    const float zMid = 0.5f * (zDoor0 + zDoor1);
+    const RouteArcTable& arc = RouteArc();
+    const glm::vec3& c = arc.points[seg];
+    const glm::vec3& n = arc.points[(seg + 1) % ROUTE_POINT_COUNT];
+    return c + (n - c) * t;
+}
 
-    float floorTopWorld = (busCenter.y - busHeight * 0.5f) + 0.10f * 0.5f;
-    float yWorld = floorTopWorld + 0.25f;
+double BusLogic::timeToNextPoint() const
+{
+    float len = std::max(pathSegmentLength(s.currentRoutePoint), 1e-6f);
+    return (double)std::max(0.0f, 1.0f - s.travelT) * len / BUS_WORLD_SPEED;
+}
 
-    float wallX = busCenter.x + busWidth * 0.5f;
+// Moves within the current segment; the caller never passes more than
+// timeToNextPoint().
+void BusLogic::moveAlongRoute(float dt)
+{
+    float len = std::max(pathSegmentLength(s.currentRoutePoint), 1e-6f);
 
-    float xWorld = wallX - 0.05f;
+    s.travelT = std::min(s.travelT + (BUS_WORLD_SPEED / len) * dt, 1.0f);
+    s.busPos = pathPosition(s.currentRoutePoint, s.travelT);
+}
 
-    return glm::vec3(xWorld, yWorld, busCenter.z + zMid);
+void BusLogic::reachNextPoint()
+{
+    s.currentRoutePoint = (s.currentRoutePoint + 1) % ROUTE_POINT_COUNT;
+    s.travelT = 0.0f;
+    s.busPos = RouteArc().points[s.currentRoutePoint];
 }
 
-glm::vec3 BusLogic::insideTargetPos() const
+void BusLogic::processDoorAction(double dt)
 {
-    const float busLength = 7.0f;
-    const float busHeight = 0.98f;
+    if (s.doorAction == DoorAction::NONE) return;
+
+    s.doorActionTimer -= (float)dt;
+    if (s.doorActionTimer <= 0.0f)
+    {
+        s.doorAction = DoorAction::NONE;
+        s.doorActionTimer = 0.0f;
+    }
+}
 
-    glm::vec3 busCenter = glm::vec3(0.0f, 1.10f, 2.30f);
+// Riders without a seat (layout full) gather at one spot.
+glm::vec3 BusLogic::seatPos(int seat) const
+{
+    const SeatLayout& layout = geometry->seats;
+    if (seat < 0 || seat >= layout.count()) return geometry->insideSpot;
+    return layout.seat(seat).pos;
+}
 
-    float floorTopWorld = (busCenter.y - busHeight * 0.5f) + 0.10f * 0.5f;
-    float yWorld = floorTopWorld + 0.25f;
+void BusLogic::freeSeat(Actor& a)
+{
+    seats.release(a.seat);
+    a.seat = -1;
+}
 
-    float xWorld = busCenter.x + 0.20f;
-    float zWorld = busCenter.z + (busLength * 0.20f);
+// Riders go through the door one by one: an actor that has to wait starts
+// with a negative t and stays at its start position until its turn.
+float BusLogic::queueThroughDoor(Actor& a)
+{
+    float delay = doorQueue;
+    doorQueue = delay + DOOR_SPACING;
 
-    return glm::vec3(xWorld, yWorld, zWorld);
+    a.pos = a.startPos;
+    a.t = -delay / std::max(0.001f, a.duration);
+    return delay + a.duration;
 }
 
-void BusLogic::startEnterActor(ActorType type)
+float BusLogic::startEnterActor(ActorType type)
 {
     Actor a;
     a.id = nextId++;
@@ -210,120 +349,112 @@ void BusLogic::startEnterActor(ActorType type)
 
     a.anim = ActorAnim::Entering;
 
-    a.startPos = doorOutsidePos();
-    a.midPos = doorThresholdPos();
-    a.endPos = insideTargetPos();
+    a.seat = seats.acquire();
+
+    a.startPos = geometry->doorOutside;
+    a.midPos = geometry->doorThreshold;
+    a.endPos = seatPos(a.seat);
     a.useMid = true;
 
-    a.pos = a.startPos;
-    a.t = 0.0f;
     a.duration = (type == ActorType::Control) ? CONTROL_MOVE_TIME : PASSENGER_MOVE_TIME;
+    float total = queueThroughDoor(a);
 
-    moving = a;
-    movingActive = true;
+    moving.push_back(a);
+    movingPaths.push(a);
+    return total;
 }
 
 
-void BusLogic::startExitActor()
+float BusLogic::startExitActor()
 {
-    if (inside.empty()) return;
+    if (inside.empty()) return 0.0f;
 
-    int idxControl = -1;
-    for (int i = 0; i < (int)inside.size(); i++)
-    {
-        if (inside[i].type == ActorType::Control) { idxControl = i; break; }
-    }
+    ActorHandle h = inside.oldest(ActorType::Control);
+    if (!h.valid()) h = inside.oldest(ActorType::Passenger);
 
-    Actor a;
-    if (idxControl >= 0)
-    {
-        a = inside[idxControl];
-        inside.erase(inside.begin() + idxControl);
-    }
-    else
-    {
-        a = inside.front();
-        inside.pop_front();
-    }
+    return startExitActor(h);
+}
+
+float BusLogic::startExitActor(ActorHandle h)
+{
+    const Actor* found = inside.get(h);
+    if (!found) return 0.0f;
+
+    Actor a = *found;
+    inside.erase(h);
 
     a.anim = ActorAnim::Exiting;
 
-    a.startPos = insideTargetPos();
-    a.midPos = doorThresholdPos();
-    a.endPos = doorOutsidePos();
+    a.startPos = seatPos(a.seat);
+    freeSeat(a);
+    a.midPos = geometry->doorThreshold;
+    a.endPos = geometry->doorOutside;
     a.useMid = true;
 
-    a.pos = a.startPos;
-    a.t = 0.0f;
     a.duration = (a.type == ActorType::Control) ? CONTROL_MOVE_TIME : PASSENGER_MOVE_TIME;
+    float total = queueThroughDoor(a);
 
-    moving = a;
-    movingActive = true;
+    moving.push_back(a);
+    movingPaths.push(a);
+    return total;
 }
 
-void BusLogic::updateMovingActor(float dt)
+void BusLogic::updateMovingActors(float dt)
 {
-    if (!movingActive) return;
+    doorQueue = std::max(0.0f, doorQueue - dt);
+    if (moving.empty()) return;
 
-    moving.t += (dt / std::max(0.001f, moving.duration));
-    float t01 = clamp01(moving.t);
+    AdvanceActorPaths(movingPaths, dt);
 
-    if (!moving.useMid)
-    {
-        float k = smooth01(t01);
-        moving.pos = moving.startPos + (moving.endPos - moving.startPos) * k;
-    }
-    else
+    // Retire every finished animation in one compaction pass.
+    size_t keep = 0;
+    for (size_t i = 0; i < moving.size(); i++)
     {
-        if (t01 < 0.5f)
-        {
-            float k = smooth01(t01 / 0.5f);
-            moving.pos = moving.startPos + (moving.midPos - moving.startPos) * k;
-        }
-        else
+        Actor& a = moving[i];
+        a.t = movingPaths.t[i];
+        a.pos = movingPaths.position(i);
+
+        if (a.t >= 1.0f)
         {
-            float k = smooth01((t01 - 0.5f) / 0.5f);
-            moving.pos = moving.midPos + (moving.endPos - moving.midPos) * k;
+            if (a.anim == ActorAnim::Entering)
+            {
+                a.anim = ActorAnim::Inside;
+                a.pos = seatPos(a.seat);
+                inside.insert(a);
+            }
+            continue;
         }
-    }
 
-    if (moving.t >= 1.0f)
-    {
-        if (moving.anim == ActorAnim::Entering)
+        if (keep != i)
         {
-            moving.anim = ActorAnim::Inside;
-            moving.pos = insideTargetPos();
-            inside.push_back(moving);
+            moving[keep] = a;
+            movingPaths.move((int)keep, (int)i);
         }
-
-        movingActive = false;
-        moving = Actor{};
+        keep++;
     }
+    moving.resize(keep);
+    movingPaths.resize((int)keep);
 }
 
 bool BusLogic::tryPassengerEnter()
 {
     if (!s.atStop) return false;
-    if (movingActive) return false;
-    if (s.doorAction != DoorAction::NONE) return false;
+    if (s.doorAction == DoorAction::EXITING) return false;
     if (s.controlInside) return false;
-    if (s.passengers >= 50) return false;
+    if (s.passengers >= BUS_CAPACITY) return false;
 
     s.passengers++;
     s.passengerCount = s.passengers;
 
     s.doorAction = DoorAction::ENTERING;
-    s.doorActionTimer = PASSENGER_MOVE_TIME;
-
-    startEnterActor(ActorType::Passenger);
+    s.doorActionTimer = std::max(s.doorActionTimer, startEnterActor(ActorType::Passenger));
     return true;
 }
 
 bool BusLogic::tryPassengerExit()
 {
     if (!s.atStop) return false;
-    if (movingActive) return false;
-    if (s.doorAction != DoorAction::NONE) return false;
+    if (s.doorAction == DoorAction::ENTERING) return false;
     if (s.controlInside) return false;
     if (s.passengers <= 0) return false;
 
@@ -333,41 +464,57 @@ bool BusLogic::tryPassengerExit()
     s.passengerCount = s.passengers;
 
     s.doorAction = DoorAction::EXITING;
-    s.doorActionTimer = PASSENGER_MOVE_TIME;
-
-    startExitActor();
+    s.doorActionTimer = std::max(s.doorActionTimer, startExitActor());
     return true;
 }
 
 bool BusLogic::tryControlEnter()
 {
     if (!s.atStop) return false;
-    if (movingActive) return false;
-    if (s.doorAction != DoorAction::NONE) return false;
+    if (s.doorAction == DoorAction::EXITING) return false;
     if (s.controlInside) return false;
-    if (s.passengers >= 50) return false;
+    if (s.passengers >= BUS_CAPACITY) return false;
 
     s.controlInside = true;
     s.passengers++;
     s.passengerCount = s.passengers;
 
     s.doorAction = DoorAction::ENTERING;
-    s.doorActionTimer = CONTROL_MOVE_TIME;
-
-    startEnterActor(ActorType::Control);
+    s.doorActionTimer = std::max(s.doorActionTimer, startEnterActor(ActorType::Control));
     return true;
 }
 
+int BusLogic::boardPassengers(int count)
+{
+    int started = 0;
+    while (started < count && tryPassengerEnter()) started++;
+    return started;
+}
+
+int BusLogic::alightPassengers(int count)
+{
+    int started = 0;
+    while (started < count && tryPassengerExit()) started++;
+    return started;
+}
+
+bool BusLogic::apply(SimCommand cmd)
+{
+    switch (cmd)
+    {
+    case SimCommand::PassengerEnter: return tryPassengerEnter();
+    case SimCommand::PassengerExit:  return tryPassengerExit();
+    case SimCommand::ControlEnter:   return tryControlEnter();
+    }
+    return false;
+}
+
 void BusLogic::controlExitAndFine()
 {
     int passengerOnly = s.passengers - 1;
     if (passengerOnly < 0) passengerOnly = 0;
 
-    if (passengerOnly > 0)
-    {
-        int numFines = rand() % (passengerOnly + 1);
-        s.totalFines += numFines;
-    }
+    s.totalFines += DrawFines(SimRandom(rngSeed, rngStream, stopVisits, RandomLane::Fine), passengerOnly);
 
     if (s.passengers > 0) s.passengers--;
     s.passengerCount = s.passengers;
@@ -1,32 +1,36 @@
 ﻿#pragma once
 #include <glm/glm.hpp>
-#include <deque>
+#include <vector>
+#include <cstdint>
+#include "Actor.h"
+#include "ActorPool.h"
+#include "ActorAnimKernel.h"
+#include "PassengerDemand.h"
+#include "SimRandom.h"
+#include "BusGeometry.h"
 
 enum class DoorState { CLOSED, OPENING, OPEN, CLOSING };
 enum class DoorAction { NONE, ENTERING, EXITING };
 
-enum class ActorType { Passenger, Control };
-enum class ActorAnim { None, Entering, Inside, Exiting };
+enum class SimCommand { PassengerEnter, PassengerExit, ControlEnter };
 
-struct Actor
-{
-    int id = 0;
-    ActorType type = ActorType::Passenger;
-
-    int modelIndex = 0;
-    ActorAnim anim = ActorAnim::None;
-
-    glm::vec3 pos = glm::vec3(0.0f);
-    glm::vec3 startPos = glm::vec3(0.0f);
+static constexpr double STOP_DWELL_TIME = 10.0;
+static constexpr float BUS_WORLD_SPEED = 1.25f;
+static constexpr int BUS_CAPACITY = 50;
 
-    glm::vec3 midPos = glm::vec3(0.0f);
-    bool useMid = false;
+// Door paths: outside -> threshold -> seat, half the time on each leg.
+static constexpr float PASSENGER_MOVE_TIME = 1.6f;
+static constexpr float CONTROL_MOVE_TIME = 2.4f;
 
-    glm::vec3 endPos = glm::vec3(0.0f);
+// Gap between two riders passing through the door.
+static constexpr float DOOR_SPACING = 0.4f;
 
-    float t = 0.0f;
-    float duration = 1.0f; 
-};
+// The inspector fines a uniformly drawn number of the riders on board.
+inline int DrawFines(uint32_t r, int passengerOnly)
+{
+    if (passengerOnly <= 0) return 0;
+    return SimRandomBelow(r, passengerOnly + 1);
+}
 
 struct BusState
 {
@@ -55,40 +59,97 @@ public:
     void reset(double now);
     void update(double now, double dt);
 
+    void setRandomStream(uint64_t seed, uint32_t busId);
+
     bool tryPassengerEnter();
     bool tryPassengerExit();
     bool tryControlEnter();
+    bool apply(SimCommand cmd);
 
-    const BusState& state() const { return s; }
+    // Earliest time after `now` at which update() would change the state
+    // without any input: stop departure, arrival at the next route point,
+    // end of a door action or of an actor animation.
+    double nextEventTime(double now) const;
 
-    const std::deque<Actor>& insideActors() const { return inside; }
-    bool hasMovingActor() const { return movingActive; }
-    const Actor& movingActor() const { return moving; }
+    const BusState& state() const { return s; }
+    uint64_t stopsVisited() const { return stopVisits; }
+
+    const ActorPool& insideActors() const { return inside; }
+    const SeatAllocator& seatAllocator() const { return seats; }
+
+    // Body the riders walk through; it must outlive the bus. Only switch it
+    // while nobody is on board, the seat allocator starts over.
+    void setGeometry(const BusGeometry& g);
+    const BusGeometry& busGeometry() const { return *geometry; }
+    bool hasMovingActor() const { return !moving.empty(); }
+    const std::vector<Actor>& movingActors() const { return moving; }
+
+    // Start up to `count` boardings or alightings in one go; riders queue
+    // through the door one after another. Returns how many were started.
+    int boardPassengers(int count);
+    int alightPassengers(int count);
+
+    // With a demand model set, every stop visit boards and drops riders on
+    // its own; clicks and scripted commands keep working on top of it.
+    void setDemand(const PassengerDemand* model);
+    const DemandTotals& demandTotals() const { return demandStats; }
+
+    // Drive along the route spline instead of the polyline. Segments keep
+    // their indices; only their lengths and the in-between positions change.
+    void setSmoothPath(bool enabled);
+    bool smoothPath() const { return smooth; }
+
+    // Binary snapshot of the whole bus (see BusSnapshot.h). `now` is the
+    // sim time the snapshot was taken at; restore hands it back.
+    bool saveSnapshot(double now, std::vector<uint8_t>& out) const;
+    bool restoreSnapshot(const void* data, size_t size, double* now = nullptr);
 
     static constexpr int SKIN_COUNT = 18;
 
 private:
     BusState s;
 
+    uint64_t rngSeed = 0;
+    uint32_t rngStream = 0;
+    uint64_t stopVisits = 0;   // also keys the random draws of each visit
+
+    const BusGeometry* geometry = &StandardBusGeometry();
+
     int nextId = 1;
-    std::deque<Actor> inside;
+    ActorPool inside;
+    SeatAllocator seats;
+
+    std::vector<Actor> moving;
+    ActorPaths movingPaths;   // animation data for `moving`, same order
 
-    bool movingActive = false;
-    Actor moving;
+    const PassengerDemand* demand = nullptr;
+    std::vector<int32_t> ridersTo;
+    std::vector<double> lastStopVisit;
+    std::vector<int32_t> waitingAt;   // riders a full bus left behind, per stop
+    DemandTotals demandStats;
+    float doorQueue = 0.0f;
+    bool smooth = false;
 
     void arriveToStop(double now);
     void leaveStop();
 
     void processDoorAction(double dt);
-    bool moveAlongRoute(float dt);
+    double timeToNextPoint() const;
+    void moveAlongRoute(float dt);
+    void reachNextPoint();
+    float pathSegmentLength(int seg) const;
+    glm::vec3 pathPosition(int seg, float t) const;
 
     void controlExitAndFine();
 
-    void startEnterActor(ActorType type);
-    void startExitActor();
-    void updateMovingActor(float dt);
+    float startEnterActor(ActorType type);
+    float startExitActor();
+    float startExitActor(ActorHandle h);
+    void applyDemand(double now);
+    StopDemandResult applyStopResult(StopDemandResult r);
+    float queueThroughDoor(Actor& a);
+    void updateMovingActors(float dt);
 
-    glm::vec3 doorOutsidePos() const;
-    glm::vec3 doorThresholdPos() const;
-    glm::vec3 insideTargetPos() const;
+    glm::vec3 seatPos(int seat) const;
+    void freeSeat(Actor& a);
 };
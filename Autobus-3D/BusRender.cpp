@@ -32,10 +32,8 @@ namespace BusRender
         return glm::scale(glm::translate(glm::mat4(1.0f), c), s);
     }
 
-    void DrawWorldAndBus(RenderCtx& ctx, const BusLogic& logic, SceneState& out)
+    void DrawWorldAndBus(RenderCtx& ctx, const BusState& st, SceneState& out)
     {
-        const auto& st = logic.state();
-
         glUseProgram(ctx.shader);
 
         glUniform3f(ctx.loc_uLightPos, out.lightPos.x, out.lightPos.y, out.lightPos.z);
@@ -59,24 +57,13 @@ namespace BusRender
         ApplyTint(ctx, glm::vec4(1.0f, 1.0f, 0.9f, 1.0f));
         DrawCube(ctx, Lamp);
 
-        glm::vec3 panelCenter = glm::vec3(-0.25f, 0.67f, -0.62f);
-        glm::vec3 panelSize = glm::vec3(1.5f, 0.42f, 0.48f);
-        glm::vec3 panelHinge = panelCenter + glm::vec3(0.0f, 0.5f * panelSize.y, -0.5f * panelSize.z);
-
-        glm::mat4 Panel(1.0f);
-        Panel = glm::translate(Panel, panelHinge);
-        Panel = glm::rotate(Panel, glm::radians(-12.0f), glm::vec3(1, 0, 0));
-        Panel = glm::translate(Panel, -panelHinge);
-        Panel = glm::translate(Panel, panelCenter);
-        Panel = glm::scale(Panel, panelSize);
-
-        out.PanelLocal = Panel;
+        const BusGeometry& bus = *out.bus;
 
         ApplyTint(ctx, ctx.COL_PANEL);
-        drawCubeLocal(Panel);
+        drawCubeLocal(bus.panelLocal);
 
-        glm::vec3 frameC = glm::vec3(0.0f, 1.15f, -1.20f);
-        glm::vec3 outerS = glm::vec3(2.4f, 0.95f, 0.08f);
+        glm::vec3 frameC = bus.windscreenCenter;
+        glm::vec3 outerS = bus.windscreenSize;
         float t = 0.12f;
 
         ApplyTint(ctx, ctx.COL_FRAME);
@@ -93,9 +80,7 @@ namespace BusRender
         drawCubeLocal(Left);
         drawCubeLocal(Right);
 
-        glm::vec3 glassC = glm::vec3(0.0f, 1.15f, -1.15f);
-        glm::vec3 glassS = glm::vec3(2.3f, 0.88f, 0.03f);
-        glm::mat4 Glass = BoxTRS(glassC, glassS);
+        glm::mat4 Glass = BoxTRS(bus.glassCenter, bus.glassSize);
 
         glUniform1i(ctx.loc_transparent, 1);
         ApplyTint(ctx, glm::vec4(0.25f, 0.28f, 0.33f, 0.28f));
@@ -107,58 +92,23 @@ namespace BusRender
         glDepthMask(GL_TRUE);
         glUniform1i(ctx.loc_transparent, 0);
 
-        const float busWidth = 2.4f;
-        const float busHeight = 0.98f;
-        const float busLength = 7.0f;
-        glm::vec3 busCenter = glm::vec3(0.0f, 1.10f, 2.30f);
-
-        auto Box = [&](glm::vec3 c, glm::vec3 s, const glm::vec4& tint)
-            {
-                glm::mat4 M = BoxTRS(c, s);
-                ApplyTint(ctx, tint);
-                drawCubeLocal(M);
-            };
-
-        Box(busCenter + glm::vec3(0.0f, -busHeight * 0.5f, 0.0f), glm::vec3(busWidth, 0.10f, busLength), ctx.COL_FLOOR);
-        Box(busCenter + glm::vec3(0.0f, +busHeight * 0.5f, 0.0f), glm::vec3(busWidth, 0.10f, busLength), ctx.COL_ROOF);
-        Box(busCenter + glm::vec3(-busWidth * 0.5f, 0.0f, 0.0f), glm::vec3(0.08f, busHeight, busLength), ctx.COL_WALL);
-
+        for (const BusBox& b : bus.shell)
         {
-            const float zFront = -busLength * 0.5f;
-            const float zBack = +busLength * 0.5f;
-            const float zDoor0 = zFront;
-            const float zDoor1 = zFront + 1.20f;
-            const float wallT = 0.08f;
-
-            auto RightWallSegment = [&](float z0, float z1)
-                {
-                    float segLen = (z1 - z0);
-                    if (segLen <= 0.001f) return;
-
-                    glm::vec3 c = busCenter + glm::vec3(+busWidth * 0.5f, 0.0f, (z0 + z1) * 0.5f);
-                    glm::vec3 s = glm::vec3(wallT, busHeight, segLen);
-                    Box(c, s, ctx.COL_WALL);
-                };
-
-            RightWallSegment(zDoor1, zBack);
-
-            const float wallDoorT = 0.06f;
-            const float doorLen = (zDoor1 - zDoor0);
-
-            glm::vec3 doorCenterClosed =
-                busCenter + glm::vec3(+busWidth * 0.5f - wallDoorT * 0.5f, 0.0f, (zDoor0 + zDoor1) * 0.5f);
-
-            glm::vec3 hinge =
-                busCenter + glm::vec3(+busWidth * 0.5f, 0.0f, zDoor0);
+            const glm::vec4& tint = (b.part == BusPart::Floor) ? ctx.COL_FLOOR
+                : (b.part == BusPart::Roof) ? ctx.COL_ROOF : ctx.COL_WALL;
+            ApplyTint(ctx, tint);
+            drawCubeLocal(b.transform);
+        }
 
+        {
             float doorAnim = st.atStop ? 1.0f : 0.0f;
-            float angle = glm::radians(80.0f * doorAnim);
+            float angle = glm::radians(bus.type.doorOpenDeg * doorAnim);
 
             glm::mat4 M(1.0f);
-            M = glm::translate(M, hinge);
+            M = glm::translate(M, bus.doorHinge);
             M = glm::rotate(M, angle, glm::vec3(0, 1, 0));
-            M = glm::translate(M, doorCenterClosed - hinge);
-            M = glm::scale(M, glm::vec3(wallDoorT, busHeight, doorLen));
+            M = glm::translate(M, bus.doorCenterClosed - bus.doorHinge);
+            M = glm::scale(M, bus.doorSize);
 
             GLboolean wasCullDoor = glIsEnabled(GL_CULL_FACE);
             glDisable(GL_CULL_FACE);
@@ -237,7 +187,7 @@ namespace BusRender
     }
 
     void DrawActors(RenderCtx& ctx, const SceneState& s, const Model& controlModel, std::vector<Model>& people,
-        const std::deque<Actor>& insideActors, bool hasMoving, const Actor& movingActor)
+        const ActorPool& insideActors, const std::vector<Actor>& movingActors)
     {
         Shader& sh = *ctx.modelShader;
         sh.use();
@@ -252,10 +202,16 @@ namespace BusRender
         const float CHAR_Y_OFF = -0.2f;
         const glm::vec3 CHAR_PIVOT(-0.1f, 0.0f, 0.0f);
 
+        const SeatLayout& seats = s.bus->seats;
+
         auto drawOne = [&](const Actor& a, bool isMoving)
             {
                 float yaw = 180.0f;
-                if (isMoving)
+                if (!isMoving && a.seat >= 0 && a.seat < seats.count())
+                {
+                    yaw = seats.seat(a.seat).yawDeg;
+                }
+                else if (isMoving)
                 {
                     glm::vec3 dir = a.endPos - a.startPos;
                     if (a.anim == ActorAnim::Exiting) dir = -dir;
@@ -290,8 +246,8 @@ namespace BusRender
                 if (wasCull && ctx.cullEnabled) glEnable(GL_CULL_FACE);
             };
 
-        for (const auto& a : insideActors) drawOne(a, false);
-        if (hasMoving) drawOne(movingActor, true);
+        insideActors.forEach([&](const Actor& a) { drawOne(a, false); });
+        for (const Actor& a : movingActors) drawOne(a, true);
 
         glUseProgram(ctx.shader);
     }
@@ -2,10 +2,10 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <vector>
-#include <deque>
 #include "shader.hpp"
 #include "model.hpp"
 #include "BusLogic.h"
+#include "BusGeometry.h"
 
 struct RenderCtx
 {
@@ -36,16 +36,16 @@ struct SceneState
     glm::vec3 busOffset;
     glm::vec3 lightPos;
 
-    glm::mat4 PanelLocal;
+    const BusGeometry* bus = &StandardBusGeometry();
 };
 
 namespace BusRender
 {
-    void DrawWorldAndBus(RenderCtx& ctx, const BusLogic& logic, SceneState& out);
+    void DrawWorldAndBus(RenderCtx& ctx, const BusState& st, SceneState& out);
 
     void DrawSteeringWheel(RenderCtx& ctx, const SceneState& s,
         Model& steeringWheel, float wheelSteerDeg, float wheelTiltDeg);
 
     void DrawActors(RenderCtx& ctx, const SceneState& s, const Model& controlModel, std::vector<Model>& people,
-        const std::deque<Actor>& insideActors, bool hasMoving, const Actor& movingActor);
+        const ActorPool& insideActors, const std::vector<Actor>& movingActors);
 }
@@ -0,0 +1,296 @@
+#include "BusSnapshot.h"
+#include "BusLogic.h"
+#include "RouteData.h"
+#include "MappedFile.h"
+#include <cstring>
+#include <fstream>
+
+static const char SNAPSHOT_MAGIC[8] = { 'B', 'U', 'S', 'S', 'N', 'A', 'P', 0 };
+
+static uint64_t Align8(uint64_t x) { return (x + 7) & ~(uint64_t)7; }
+
+static SnapshotActor PackActor(const Actor& a)
+{
+    SnapshotActor r;
+    memset(&r, 0, sizeof(r));
+
+    r.id = a.id;
+    r.type = (int32_t)a.type;
+    r.modelIndex = a.modelIndex;
+    r.anim = (int32_t)a.anim;
+
+    for (int c = 0; c < 3; c++)
+    {
+        r.pos[c] = a.pos[c];
+        r.startPos[c] = a.startPos[c];
+        r.midPos[c] = a.midPos[c];
+        r.endPos[c] = a.endPos[c];
+    }
+
+    r.t = a.t;
+    r.duration = a.duration;
+    r.useMid = a.useMid ? 1 : 0;
+    r.seat = a.seat;
+    return r;
+}
+
+static Actor UnpackActor(const SnapshotActor& r)
+{
+    Actor a;
+    a.id = r.id;
+    a.type = (ActorType)r.type;
+    a.modelIndex = r.modelIndex;
+    a.anim = (ActorAnim)r.anim;
+
+    for (int c = 0; c < 3; c++)
+    {
+        a.pos[c] = r.pos[c];
+        a.startPos[c] = r.startPos[c];
+        a.midPos[c] = r.midPos[c];
+        a.endPos[c] = r.endPos[c];
+    }
+
+    a.t = r.t;
+    a.duration = r.duration;
+    a.useMid = r.useMid != 0;
+    a.seat = r.seat;
+    return a;
+}
+
+// Enum fields are checked against the last enumerator before they are cast.
+static bool EnumFits(int32_t v, int last) { return v >= 0 && v <= last; }
+
+static bool ActorRecordValid(const SnapshotActor& r)
+{
+    return EnumFits(r.type, (int)ActorType::Control) && EnumFits(r.anim, (int)ActorAnim::Exiting);
+}
+
+static bool StateRecordValid(const SnapshotBusState& st)
+{
+    return st.currentRoutePoint >= 0 && st.currentRoutePoint < ROUTE_POINT_COUNT
+        && EnumFits(st.doorState, (int)DoorState::CLOSING)
+        && EnumFits(st.doorAction, (int)DoorAction::EXITING);
+}
+
+static bool SectionFits(uint64_t offset, uint64_t bytes, uint64_t size)
+{
+    return offset % 8 == 0 && offset <= size && bytes <= size - offset;
+}
+
+const SnapshotHeader* ValidateSnapshot(const void* data, size_t size)
+{
+    if (!data || size < sizeof(SnapshotHeader)) return nullptr;
+
+    const SnapshotHeader* h = (const SnapshotHeader*)data;
+    if (memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) return nullptr;
+    if (h->version != SNAPSHOT_VERSION || h->byteOrder != SNAPSHOT_BYTE_ORDER) return nullptr;
+    if (h->totalSize > size) return nullptr;
+
+    uint64_t n = h->totalSize;
+    if (!SectionFits(h->stateOffset, sizeof(SnapshotBusState), n)) return nullptr;
+    if (!SectionFits(h->insideOffset, (uint64_t)h->insideCount * sizeof(SnapshotActor), n)) return nullptr;
+    if (!SectionFits(h->movingOffset, (uint64_t)h->movingCount * sizeof(SnapshotActor), n)) return nullptr;
+    if (!SectionFits(h->ridersOffset, (uint64_t)h->demandStops * sizeof(int32_t), n)) return nullptr;
+    if (!SectionFits(h->lastVisitOffset, (uint64_t)h->demandStops * sizeof(double), n)) return nullptr;
+    if (!SectionFits(h->waitingOffset, (uint64_t)h->demandStops * sizeof(int32_t), n)) return nullptr;
+
+    return h;
+}
+
+bool BusLogic::saveSnapshot(double now, std::vector<uint8_t>& out) const
+{
+    std::vector<SnapshotActor> insideRecords;
+    insideRecords.reserve(inside.size());
+    inside.forEachOldestFirst(ActorType::Passenger, [&](const Actor& a) { insideRecords.push_back(PackActor(a)); });
+    inside.forEachOldestFirst(ActorType::Control, [&](const Actor& a) { insideRecords.push_back(PackActor(a)); });
+
+    SnapshotHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    h.version = SNAPSHOT_VERSION;
+    h.byteOrder = SNAPSHOT_BYTE_ORDER;
+    h.simTime = now;
+
+    h.rngSeed = rngSeed;
+    h.stopVisits = stopVisits;
+    h.rngStream = rngStream;
+    h.nextId = nextId;
+
+    h.insideCount = (uint32_t)insideRecords.size();
+    h.movingCount = (uint32_t)moving.size();
+    h.demandStops = (uint32_t)ridersTo.size();
+    h.doorQueue = doorQueue;
+
+    h.demandBoarded = demandStats.boarded;
+    h.demandAlighted = demandStats.alighted;
+    h.demandDenied = demandStats.denied;
+
+    h.stateOffset = sizeof(SnapshotHeader);
+    h.insideOffset = h.stateOffset + sizeof(SnapshotBusState);
+    h.movingOffset = h.insideOffset + (uint64_t)h.insideCount * sizeof(SnapshotActor);
+    h.ridersOffset = h.movingOffset + (uint64_t)h.movingCount * sizeof(SnapshotActor);
+    h.lastVisitOffset = Align8(h.ridersOffset + (uint64_t)h.demandStops * sizeof(int32_t));
+    h.waitingOffset = h.lastVisitOffset + (uint64_t)h.demandStops * sizeof(double);
+    h.totalSize = h.waitingOffset + (uint64_t)h.demandStops * sizeof(int32_t);
+
+    SnapshotBusState st;
+    memset(&st, 0, sizeof(st));
+    st.passengers = s.passengers;
+    st.passengerCount = s.passengerCount;
+    st.controlInside = s.controlInside ? 1 : 0;
+    st.totalFines = s.totalFines;
+    st.currentRoutePoint = s.currentRoutePoint;
+    st.travelT = s.travelT;
+    st.atStop = s.atStop ? 1 : 0;
+    st.doorState = (int32_t)s.doorState;
+    st.stopStartTime = s.stopStartTime;
+    st.doorAction = (int32_t)s.doorAction;
+    st.doorActionTimer = s.doorActionTimer;
+    for (int c = 0; c < 3; c++) st.busPos[c] = s.busPos[c];
+
+    out.assign((size_t)h.totalSize, 0);
+    uint8_t* p = out.data();
+
+    memcpy(p, &h, sizeof(h));
+    memcpy(p + h.stateOffset, &st, sizeof(st));
+    if (!insideRecords.empty())
+        memcpy(p + h.insideOffset, insideRecords.data(), insideRecords.size() * sizeof(SnapshotActor));
+    for (size_t i = 0; i < moving.size(); i++)
+    {
+        SnapshotActor r = PackActor(moving[i]);
+        memcpy(p + h.movingOffset + i * sizeof(SnapshotActor), &r, sizeof(r));
+    }
+    if (!ridersTo.empty())
+    {
+        memcpy(p + h.ridersOffset, ridersTo.data(), ridersTo.size() * sizeof(int32_t));
+        memcpy(p + h.lastVisitOffset, lastStopVisit.data(), lastStopVisit.size() * sizeof(double));
+        memcpy(p + h.waitingOffset, waitingAt.data(), waitingAt.size() * sizeof(int32_t));
+    }
+    return true;
+}
+
+bool BusLogic::restoreSnapshot(const void* data, size_t size, double* now)
+{
+    const SnapshotHeader* h = ValidateSnapshot(data, size);
+    if (!h) return false;
+
+    // The demand model is not part of the snapshot; its stop count must match.
+    if (demand && (int)h->demandStops != demand->stopCount()) return false;
+
+    const uint8_t* p = (const uint8_t*)data;
+
+    // Everything is checked before anything is changed, so a bad file
+    // leaves the bus as it was.
+    SnapshotBusState st;
+    memcpy(&st, p + h->stateOffset, sizeof(st));
+    if (!StateRecordValid(st)) return false;
+
+    const uint64_t actorOffsets[2] = { h->insideOffset, h->movingOffset };
+    const uint32_t actorCounts[2] = { h->insideCount, h->movingCount };
+    for (int section = 0; section < 2; section++)
+    {
+        for (uint32_t i = 0; i < actorCounts[section]; i++)
+        {
+            SnapshotActor r;
+            memcpy(&r, p + actorOffsets[section] + i * sizeof(SnapshotActor), sizeof(r));
+            if (!ActorRecordValid(r)) return false;
+        }
+    }
+
+    s.passengers = st.passengers;
+    s.passengerCount = st.passengerCount;
+    s.controlInside = st.controlInside != 0;
+    s.totalFines = st.totalFines;
+    s.currentRoutePoint = st.currentRoutePoint;
+    s.travelT = st.travelT;
+    s.atStop = st.atStop != 0;
+    s.doorState = (DoorState)st.doorState;
+    s.stopStartTime = st.stopStartTime;
+    s.doorAction = (DoorAction)st.doorAction;
+    s.doorActionTimer = st.doorActionTimer;
+    s.busPos = glm::vec3(st.busPos[0], st.busPos[1], st.busPos[2]);
+
+    rngSeed = h->rngSeed;
+    rngStream = h->rngStream;
+    stopVisits = h->stopVisits;
+    nextId = h->nextId;
+    doorQueue = h->doorQueue;
+
+    demandStats.boarded = h->demandBoarded;
+    demandStats.alighted = h->demandAlighted;
+    demandStats.denied = h->demandDenied;
+
+    // Seats are re-claimed from the actors holding them; a seat index the
+    // layout no longer has (or a duplicate) leaves the actor unseated.
+    seats.reset(geometry->seats.count());
+    auto claimSeat = [&](Actor& a)
+        {
+            if (a.seat >= 0 && !seats.take(a.seat)) a.seat = -1;
+        };
+
+    inside.clear();
+    for (uint32_t i = 0; i < h->insideCount; i++)
+    {
+        SnapshotActor r;
+        memcpy(&r, p + h->insideOffset + i * sizeof(SnapshotActor), sizeof(r));
+        Actor a = UnpackActor(r);
+        claimSeat(a);
+        inside.insert(a);
+    }
+
+    moving.clear();
+    movingPaths.clear();
+    for (uint32_t i = 0; i < h->movingCount; i++)
+    {
+        SnapshotActor r;
+        memcpy(&r, p + h->movingOffset + i * sizeof(SnapshotActor), sizeof(r));
+        moving.push_back(UnpackActor(r));
+        claimSeat(moving.back());
+        movingPaths.push(moving.back());
+    }
+
+    ridersTo.resize(h->demandStops);
+    lastStopVisit.resize(h->demandStops);
+    waitingAt.resize(h->demandStops);
+    if (h->demandStops > 0)
+    {
+        memcpy(ridersTo.data(), p + h->ridersOffset, ridersTo.size() * sizeof(int32_t));
+        memcpy(lastStopVisit.data(), p + h->lastVisitOffset, lastStopVisit.size() * sizeof(double));
+        memcpy(waitingAt.data(), p + h->waitingOffset, waitingAt.size() * sizeof(int32_t));
+    }
+
+    if (now) *now = h->simTime;
+    return true;
+}
+
+bool WriteSnapshotFile(const char* path, const std::vector<uint8_t>& bytes)
+{
+    std::ofstream f(path, std::ios::binary | std::ios::trunc);
+    if (!f) return false;
+
+    f.write((const char*)bytes.data(), (std::streamsize)bytes.size());
+    return (bool)f;
+}
+
+bool LoadSnapshotFile(const char* path, BusLogic& logic, double* simTime)
+{
+    MappedFile file;
+    if (!file.open(path)) return false;
+    return logic.restoreSnapshot(file.data(), file.size(), simTime);
+}
+
+std::vector<BusLogic> ForkSnapshot(const void* data, size_t size, int count, uint64_t seed,
+    const PassengerDemand* demand)
+{
+    std::vector<BusLogic> forks;
+    if (count <= 0) return forks;
+
+    BusLogic base;
+    base.setDemand(demand);
+    if (!base.restoreSnapshot(data, size)) return forks;
+
+    forks.assign(count, base);
+    for (int i = 0; i < count; i++)
+        forks[i].setRandomStream(seed, (uint32_t)i);
+    return forks;
+}
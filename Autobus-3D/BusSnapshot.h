@@ -0,0 +1,98 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+class BusLogic;
+class PassengerDemand;
+
+constexpr uint32_t SNAPSHOT_VERSION = 4;
+constexpr uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304u;
+
+// Snapshot layout: header, bus state, inside actors (passengers then the
+// inspector, each oldest first), moving actors, then the demand arrays.
+// Every record is plain data with a fixed size and every section starts on
+// an 8-byte boundary, so a mapped file can be read in place.
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t totalSize;
+    double simTime;
+
+    uint64_t rngSeed;
+    uint64_t stopVisits;
+    uint32_t rngStream;
+    int32_t nextId;
+
+    uint32_t insideCount;
+    uint32_t movingCount;
+    uint32_t demandStops;
+    float doorQueue;
+
+    int64_t demandBoarded;
+    int64_t demandAlighted;
+    int64_t demandDenied;
+
+    uint64_t stateOffset;
+    uint64_t insideOffset;
+    uint64_t movingOffset;
+    uint64_t ridersOffset;
+    uint64_t lastVisitOffset;
+    uint64_t waitingOffset;
+};
+
+struct SnapshotBusState
+{
+    int32_t passengers;
+    int32_t passengerCount;
+    int32_t controlInside;
+    int32_t totalFines;
+
+    int32_t currentRoutePoint;
+    float travelT;
+    int32_t atStop;
+    int32_t doorState;
+    double stopStartTime;
+
+    int32_t doorAction;
+    float doorActionTimer;
+    float busPos[3];
+    uint32_t pad;
+};
+
+struct SnapshotActor
+{
+    int32_t id;
+    int32_t type;
+    int32_t modelIndex;
+    int32_t anim;
+
+    float pos[3];
+    float startPos[3];
+    float midPos[3];
+    float endPos[3];
+
+    float t;
+    float duration;
+    int32_t useMid;
+    int32_t seat;
+};
+
+static_assert(sizeof(SnapshotHeader) % 8 == 0, "snapshot header must keep 8-byte alignment");
+static_assert(sizeof(SnapshotBusState) % 8 == 0, "snapshot state must keep 8-byte alignment");
+static_assert(sizeof(SnapshotActor) % 8 == 0, "snapshot actor must keep 8-byte alignment");
+
+// Checks magic, version, byte order and that every section lies inside
+// `size`; returns the header or nullptr.
+const SnapshotHeader* ValidateSnapshot(const void* data, size_t size);
+
+bool WriteSnapshotFile(const char* path, const std::vector<uint8_t>& bytes);
+bool LoadSnapshotFile(const char* path, BusLogic& logic, double* simTime = nullptr);
+
+// Restores `count` copies of one snapshot. Fork i keeps the saved state
+// but draws from random stream i of `seed`, so the runs diverge from the
+// same warmed-up starting point.
+std::vector<BusLogic> ForkSnapshot(const void* data, size_t size, int count, uint64_t seed,
+    const PassengerDemand* demand = nullptr);
@@ -0,0 +1,33 @@
+#include "CpuFeatures.h"
+
+#if SIMD_X86 && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static bool DetectAVX2()
+{
+#if !SIMD_X86
+    return false;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx) return false;
+    if ((_xgetbv(0) & 0x6) != 0x6) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+bool CpuHasAVX2()
+{
+    static const bool avx2 = DetectAVX2();
+    return avx2;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+// SIMD helpers shared by the vectorized kernels. SIMD_X86 says whether
+// SSE/AVX intrinsics can be compiled at all; SIMD_TARGET_AVX2 marks a
+// function that uses AVX2 intrinsics (MSVC emits them without /arch:AVX2,
+// GCC/Clang need the function to be built for that target).
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#else
+#define SIMD_X86 0
+#endif
+
+#if SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SIMD_TARGET_AVX2
+#endif
+
+// Whether the CPU and OS can run AVX2 code (checked once, then cached).
+bool CpuHasAVX2();
@@ -0,0 +1,89 @@
+#include "EventSim.h"
+
+void EventSim::reset(int busCount, uint64_t seed)
+{
+    if (busCount < 0) busCount = 0;
+
+    buses.assign(busCount, BusLogic());
+    lastTime.assign(busCount, 0.0);
+    wakeToken.assign(busCount, 0);
+
+    queue = decltype(queue)();
+    nextOrder = 0;
+    processed = 0;
+    accepted = 0;
+
+    for (int i = 0; i < busCount; i++)
+    {
+        buses[i].setRandomStream(seed, (uint32_t)i);
+        buses[i].reset(0.0);
+        scheduleWake(i);
+    }
+}
+
+void EventSim::schedule(double time, int bus, SimCommand cmd)
+{
+    if (bus < 0 || bus >= size()) return;
+
+    SimEvent e;
+    e.time = time;
+    e.bus = bus;
+    e.kind = SimEventKind::Command;
+    e.cmd = cmd;
+    push(e);
+}
+
+void EventSim::runUntil(double endTime)
+{
+    while (!queue.empty() && queue.top().time <= endTime)
+    {
+        SimEvent e = queue.top();
+        queue.pop();
+
+        // A command reschedules its bus, which leaves the old wake-up stale.
+        if (e.kind == SimEventKind::Wake && e.wakeToken != wakeToken[e.bus])
+            continue;
+
+        advanceBus(e.bus, e.time);
+
+        if (e.kind == SimEventKind::Command && buses[e.bus].apply(e.cmd))
+            accepted++;
+
+        scheduleWake(e.bus);
+        processed++;
+    }
+
+    for (int i = 0; i < size(); i++)
+    {
+        if (lastTime[i] < endTime)
+        {
+            advanceBus(i, endTime);
+            scheduleWake(i);
+        }
+    }
+}
+
+void EventSim::push(SimEvent e)
+{
+    e.order = nextOrder++;
+    queue.push(e);
+}
+
+void EventSim::advanceBus(int bus, double time)
+{
+    double dt = time - lastTime[bus];
+    if (dt <= 0.0) return;
+
+    buses[bus].update(time, dt);
+    lastTime[bus] = time;
+}
+
+void EventSim::scheduleWake(int bus)
+{
+    SimEvent e;
+    e.time = buses[bus].nextEventTime(lastTime[bus]);
+    e.bus = bus;
+    e.kind = SimEventKind::Wake;
+    e.wakeToken = ++wakeToken[bus];
+    push(e);
+}
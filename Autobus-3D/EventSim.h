@@ -0,0 +1,61 @@
+#pragma once
+#include <vector>
+#include <queue>
+#include <cstdint>
+#include "BusLogic.h"
+
+enum class SimEventKind { Wake, Command };
+
+struct SimEvent
+{
+    double time = 0.0;
+    uint64_t order = 0;      // ties are processed in scheduling order
+    int bus = 0;
+    SimEventKind kind = SimEventKind::Wake;
+    SimCommand cmd = SimCommand::PassengerEnter;
+    uint32_t wakeToken = 0;
+};
+
+struct SimEventLater
+{
+    bool operator()(const SimEvent& a, const SimEvent& b) const
+    {
+        if (a.time != b.time) return a.time > b.time;
+        return a.order > b.order;
+    }
+};
+
+// Event-driven driver for a set of BusLogic instances. Instead of polling
+// every frame, each bus is only updated at its own next deadline
+// (BusLogic::nextEventTime) or when a command is scheduled for it, so time a
+// bus spends dwelling or cruising along a segment costs nothing.
+class EventSim
+{
+public:
+    void reset(int busCount, uint64_t seed);
+
+    void schedule(double time, int bus, SimCommand cmd);
+    void runUntil(double endTime);
+
+    int size() const { return (int)buses.size(); }
+    const BusLogic& bus(int i) const { return buses[i]; }
+    double busTime(int i) const { return lastTime[i]; }
+
+    uint64_t eventsProcessed() const { return processed; }
+    uint64_t commandsAccepted() const { return accepted; }
+
+private:
+    std::vector<BusLogic> buses;
+    std::vector<double> lastTime;
+    std::vector<uint32_t> wakeToken;
+
+    std::priority_queue<SimEvent, std::vector<SimEvent>, SimEventLater> queue;
+    uint64_t nextOrder = 0;
+
+    uint64_t processed = 0;
+    uint64_t accepted = 0;
+
+    void push(SimEvent e);
+    void advanceBus(int bus, double time);
+    void scheduleWake(int bus);
+};
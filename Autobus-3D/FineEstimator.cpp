@@ -0,0 +1,199 @@
+#include "FineEstimator.h"
+#include "CpuFeatures.h"
+#include "SimRandom.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+struct ShiftKernelArgs
+{
+    uint32_t seedLo;
+    uint32_t seedHi;
+    uint32_t percent;
+    uint32_t loadMin;
+    uint32_t loadRange;
+    int stops;
+
+    // One salt per (stop, lane) for the inspection, load and fine draws:
+    // salt[stop * 3 + lane] = SimHash32(stop * 3 + lane), and each draw
+    // hashes shift key ^ salt.
+    const uint32_t* salt;
+};
+
+static uint32_t ShiftKey(const ShiftKernelArgs& a, uint32_t shift)
+{
+    return SimHash32(a.seedLo ^ SimHash32(shift + a.seedHi));
+}
+
+// Fines issued during shifts [first, first + count).
+static void ShiftFinesScalar(const ShiftKernelArgs& a, uint32_t first, int count, uint32_t* out)
+{
+    for (int i = 0; i < count; i++)
+    {
+        uint32_t key = ShiftKey(a, first + (uint32_t)i);
+        uint32_t fines = 0;
+
+        for (int s = 0; s < a.stops; s++)
+        {
+            const uint32_t* salt = a.salt + s * 3;
+            bool inspected = (uint32_t)SimRandomBelow(SimHash32(key ^ salt[0]), 100) < a.percent;
+            int load = (int)a.loadMin + SimRandomBelow(SimHash32(key ^ salt[1]), (int)a.loadRange);
+            uint32_t drawn = (uint32_t)DrawFines(SimHash32(key ^ salt[2]), load);
+            fines += inspected ? drawn : 0u;
+        }
+        out[i] = fines;
+    }
+}
+
+#if SIMD_X86
+
+SIMD_TARGET_AVX2
+static inline __m256i Hash8(__m256i x)
+{
+    x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+    x = _mm256_mullo_epi32(x, _mm256_set1_epi32((int)0x7feb352du));
+    x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 15));
+    x = _mm256_mullo_epi32(x, _mm256_set1_epi32((int)0x846ca68bu));
+    x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+    return x;
+}
+
+// Per lane (r * n) >> 32, i.e. SimRandomBelow.
+SIMD_TARGET_AVX2
+static inline __m256i Below8(__m256i r, __m256i n)
+{
+    __m256i even = _mm256_srli_epi64(_mm256_mul_epu32(r, n), 32);
+    __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(r, 32), _mm256_srli_epi64(n, 32));
+    return _mm256_blend_epi32(even, odd, 0xAA);
+}
+
+SIMD_TARGET_AVX2
+static int ShiftFinesAVX2(const ShiftKernelArgs& a, uint32_t first, int count, uint32_t* out)
+{
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i seedLo = _mm256_set1_epi32((int)a.seedLo);
+    const __m256i seedHi = _mm256_set1_epi32((int)a.seedHi);
+    const __m256i percent = _mm256_set1_epi32((int)a.percent);
+    const __m256i hundred = _mm256_set1_epi32(100);
+    const __m256i loadMin = _mm256_set1_epi32((int)a.loadMin);
+    const __m256i loadRange = _mm256_set1_epi32((int)a.loadRange);
+    const __m256i one = _mm256_set1_epi32(1);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i shift = _mm256_add_epi32(_mm256_set1_epi32((int)(first + (uint32_t)i)), lane);
+        __m256i key = Hash8(_mm256_xor_si256(seedLo, Hash8(_mm256_add_epi32(shift, seedHi))));
+        __m256i fines = _mm256_setzero_si256();
+
+        for (int s = 0; s < a.stops; s++)
+        {
+            const uint32_t* salt = a.salt + s * 3;
+            __m256i inspectKey = _mm256_xor_si256(key, _mm256_set1_epi32((int)salt[0]));
+            __m256i loadKey = _mm256_xor_si256(key, _mm256_set1_epi32((int)salt[1]));
+            __m256i fineKey = _mm256_xor_si256(key, _mm256_set1_epi32((int)salt[2]));
+
+            __m256i inspected = _mm256_cmpgt_epi32(percent, Below8(Hash8(inspectKey), hundred));
+            __m256i load = _mm256_add_epi32(loadMin, Below8(Hash8(loadKey), loadRange));
+            __m256i drawn = Below8(Hash8(fineKey), _mm256_add_epi32(load, one));
+
+            fines = _mm256_add_epi32(fines, _mm256_and_si256(inspected, drawn));
+        }
+        _mm256_storeu_si256((__m256i*)(out + i), fines);
+    }
+    return i;
+}
+
+#endif
+
+static void ShiftFines(const ShiftKernelArgs& a, uint32_t first, int count, uint32_t* out, bool simd)
+{
+    int done = 0;
+#if SIMD_X86
+    if (simd && CpuHasAVX2()) done = ShiftFinesAVX2(a, first, count, out);
+#else
+    (void)simd;
+#endif
+    ShiftFinesScalar(a, first + (uint32_t)done, count - done, out + done);
+}
+
+FineEstimate EstimateFines(const FinePolicy& policy, long long shifts, uint64_t seed, int threadCount, bool allowSimd)
+{
+    FineEstimate est;
+    shifts = std::max(0LL, std::min(shifts, (long long)UINT32_MAX));
+    if (shifts == 0) return est;
+
+    ShiftKernelArgs a;
+    a.seedLo = (uint32_t)seed;
+    a.seedHi = (uint32_t)(seed >> 32);
+    a.percent = (uint32_t)std::max(0, std::min(policy.inspectionPercent, 100));
+    a.loadMin = (uint32_t)std::max(0, policy.loadMin);
+    a.loadRange = (uint32_t)std::max(1, policy.loadMax - (int)a.loadMin + 1);
+    a.stops = std::max(0, policy.stopsPerShift);
+
+    std::vector<uint32_t> salt((size_t)a.stops * 3);
+    for (size_t i = 0; i < salt.size(); i++) salt[i] = SimHash32((uint32_t)i);
+    a.salt = salt.data();
+
+    std::vector<uint32_t> fines((size_t)shifts);
+    threadCount = (int)std::max(1LL, std::min((long long)threadCount, shifts));
+
+    auto wallStart = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount);
+    for (int t = 0; t < threadCount; t++)
+    {
+        long long begin = shifts * t / threadCount;
+        long long end = shifts * (t + 1) / threadCount;
+
+        workers.emplace_back([&a, &fines, begin, end, allowSimd]()
+            {
+                const int CHUNK = 4096;
+                for (long long i = begin; i < end; i += CHUNK)
+                {
+                    int n = (int)std::min((long long)CHUNK, end - i);
+                    ShiftFines(a, (uint32_t)i, n, fines.data() + i, allowSimd);
+                }
+            });
+    }
+    for (auto& w : workers) w.join();
+
+    auto wallEnd = std::chrono::steady_clock::now();
+
+    double sum = 0.0, sumSq = 0.0;
+    for (uint32_t f : fines)
+    {
+        sum += f;
+        sumSq += (double)f * f;
+    }
+
+    const double n = (double)shifts;
+    const double amount = policy.fineAmount;
+    double meanFines = sum / n;
+
+    est.shifts = shifts;
+    est.stopDraws = shifts * a.stops;
+    est.mean = meanFines * amount;
+    est.variance = (n > 1.0) ? (sumSq - sum * meanFines) / (n - 1.0) * amount * amount : 0.0;
+
+    auto quantile = [&](double q)
+    {
+        size_t k = (size_t)std::min(n - 1.0, q * (n - 1.0) + 0.5);
+        std::nth_element(fines.begin(), fines.begin() + k, fines.end());
+        return fines[k] * amount;
+    };
+    est.p05 = quantile(0.05);
+    est.p50 = quantile(0.50);
+    est.p95 = quantile(0.95);
+    est.p99 = quantile(0.99);
+
+    est.wallSeconds = std::chrono::duration<double>(wallEnd - wallStart).count();
+    if (est.wallSeconds > 0.0)
+    {
+        est.shiftsPerSecond = n / est.wallSeconds;
+        est.stopDrawsPerSecond = (double)est.stopDraws / est.wallSeconds;
+    }
+    return est;
+}
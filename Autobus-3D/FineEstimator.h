@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include "BusLogic.h"
+
+// One inspection policy for a bus shift. At every stop an inspector gets on
+// with probability inspectionPercent; the riders aboard at that moment are
+// drawn uniformly from [loadMin, loadMax] and fined with DrawFines.
+struct FinePolicy
+{
+    int inspectionPercent = 10;
+    int stopsPerShift = 400;
+    int loadMin = 0;
+    int loadMax = BUS_CAPACITY - 1;
+    float fineAmount = 1.0f;   // revenue per fine
+};
+
+// Distribution of fine revenue per shift.
+struct FineEstimate
+{
+    long long shifts = 0;
+    long long stopDraws = 0;
+
+    double mean = 0.0;
+    double variance = 0.0;
+    double p05 = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+
+    double wallSeconds = 0.0;
+    double shiftsPerSecond = 0.0;
+    double stopDrawsPerSecond = 0.0;
+};
+
+// Simulates `shifts` independent shifts, eight at a time with AVX2 when the
+// CPU has it, split over `threadCount` threads. Shift i only depends on
+// (seed, i), so the estimate is the same for any thread count or kernel.
+FineEstimate EstimateFines(const FinePolicy& policy, long long shifts, uint64_t seed, int threadCount, bool allowSimd = true);
@@ -0,0 +1,309 @@
+#include "FleetLogic.h"
+#include "BusLogic.h"
+#include "RouteData.h"
+#include "SimRandom.h"
+#include "PassengerDemand.h"
+#include <cmath>
+#include <climits>
+#include <algorithm>
+#include <thread>
+
+// Worker blocks start on a multiple of this so every bus goes through the
+// same vector/remainder split of the hot loop whatever the thread count.
+static constexpr int FLEET_BLOCK_ALIGN = 64;
+
+// Bus grid cell size as a fraction of one lap of the route.
+static constexpr double FLEET_GRID_CELLS_PER_LAP = 64.0;
+
+void FleetLogic::reset(int busCount, uint64_t seed)
+{
+    if (busCount < 0) busCount = 0;
+
+    rngSeed = seed;
+    tick = 0;
+
+    segmentRate.resize(ROUTE_POINT_COUNT);
+    for (int i = 0; i < ROUTE_POINT_COUNT; i++)
+        segmentRate[i] = BUS_WORLD_SPEED / std::max(SegmentLength(i), 1e-6f);
+
+    hot.travelT.assign(busCount, 0.0f);
+    hot.travelRate.assign(busCount, 0.0f);
+    hot.dwellLeft.assign(busCount, 0.0f);
+
+    cold.currentRoutePoint.assign(busCount, 0);
+    cold.stopsVisited.assign(busCount, 0);
+    cold.lapsCompleted.assign(busCount, 0);
+    cold.passengers.assign(busCount, 0);
+    cold.controlInside.assign(busCount, 0);
+    cold.totalFines.assign(busCount, 0);
+
+    int demandStops = policy.demand ? STOP_COUNT : 0;
+    cold.ridersTo.assign((size_t)busCount * demandStops, 0);
+    stopWaiting.assign(demandStops, 0);
+    stopLastVisit.assign(demandStops, 0.0);
+    cold.boarded.assign(busCount, 0);
+    cold.alighted.assign(busCount, 0);
+    cold.denied.assign(busCount, 0);
+
+    if (policy.agents) policy.agents->setBusCount(busCount);
+
+    // Spread the fleet over the whole loop so buses do not move in lockstep.
+    for (int i = 0; i < busCount; i++)
+    {
+        int point = i % ROUTE_POINT_COUNT;
+        float phase = (float)(i / ROUTE_POINT_COUNT) * 0.618034f;
+
+        cold.currentRoutePoint[i] = point;
+        hot.travelT[i] = phase - std::floor(phase);
+        hot.travelRate[i] = segmentRate[point];
+    }
+
+    const RouteArcTable& arc = RouteArc();
+    glm::vec2 lo(1e30f), hi(-1e30f);
+    for (const glm::vec3& p : arc.points)
+    {
+        lo = glm::min(lo, glm::vec2(p.x, p.z));
+        hi = glm::max(hi, glm::vec2(p.x, p.z));
+    }
+    grid.reset(lo, hi, (float)(arc.totalLength() / FLEET_GRID_CELLS_PER_LAP), busCount);
+    updateGrid();
+}
+
+void FleetLogic::update(double dt)
+{
+    step(1, dt, 1);
+}
+
+void FleetLogic::step(int64_t ticks, double dt, int threadCount)
+{
+    if (ticks <= 0 || size() == 0) return;
+
+    std::vector<StopVisit> visits;
+    if (!policy.agents && !policy.demand)
+    {
+        for (int64_t done = 0; done < ticks; done += INT_MAX)
+            stepTicks((int)std::min<int64_t>(INT_MAX, ticks - done), dt, threadCount, visits);
+    }
+    else
+    {
+        // A bus dwells at least this long after pulling in, so it is still
+        // at the stop when its batch ends and visits nowhere else meanwhile.
+        const int batch = std::max(1, (int)(STOP_DWELL_TIME / dt));
+        for (int64_t done = 0; done < ticks; done += batch)
+        {
+            stepTicks((int)std::min<int64_t>(batch, ticks - done), dt, threadCount, visits);
+            applyStopVisits(visits, threadCount);
+        }
+    }
+
+    updateGrid();
+}
+
+void FleetLogic::stepTicks(int ticks, double dt, int threadCount, std::vector<StopVisit>& visits)
+{
+    const int n = size();
+    visits.clear();
+
+    int blocks = (n + FLEET_BLOCK_ALIGN - 1) / FLEET_BLOCK_ALIGN;
+    threadCount = std::max(1, std::min(threadCount, blocks));
+
+    if (threadCount == 1)
+    {
+        std::vector<int32_t> arrived;
+        stepRange(0, n, tick, ticks, (float)dt, arrived, visits);
+    }
+    else
+    {
+        std::vector<std::thread> workers;
+        std::vector<std::vector<StopVisit>> workerVisits(threadCount);
+        workers.reserve(threadCount);
+
+        for (int t = 0; t < threadCount; t++)
+        {
+            int begin = std::min(n, (blocks * t / threadCount) * FLEET_BLOCK_ALIGN);
+            int end = std::min(n, (blocks * (t + 1) / threadCount) * FLEET_BLOCK_ALIGN);
+
+            workers.emplace_back([this, begin, end, ticks, dt, &workerVisits, t]()
+                {
+                    std::vector<int32_t> arrived;
+                    stepRange(begin, end, tick, ticks, (float)dt, arrived, workerVisits[t]);
+                });
+        }
+
+        for (auto& w : workers) w.join();
+
+        for (const auto& v : workerVisits)
+            visits.insert(visits.end(), v.begin(), v.end());
+    }
+
+    tick += (uint64_t)ticks;
+}
+
+void FleetLogic::applyStopVisits(std::vector<StopVisit>& visits, int threadCount)
+{
+    if (policy.agents)
+    {
+        policy.agents->processVisits(visits, threadCount);
+    }
+    else
+    {
+        ForEachStopRun(visits, threadCount, [this, &visits](size_t first, size_t last, int)
+            {
+                for (size_t i = first; i < last; i++) visitStopWithDemand(visits[i]);
+            });
+    }
+
+    for (const StopVisit& v : visits)
+    {
+        cold.passengers[v.bus] += v.boarded - v.alighted;
+        cold.boarded[v.bus] += v.boarded;
+        cold.alighted[v.bus] += v.alighted;
+        cold.denied[v.bus] += v.denied;
+    }
+}
+
+// Most buses stay in their cell from one step to the next; only the ones
+// that crossed into another are relinked.
+void FleetLogic::updateGrid()
+{
+    const RouteArcTable& arc = RouteArc();
+    const int n = size();
+    for (int i = 0; i < n; i++)
+    {
+        int seg = cold.currentRoutePoint[i];
+        const glm::vec3& c = arc.points[seg];
+        const glm::vec3& d = arc.points[(seg + 1) % ROUTE_POINT_COUNT];
+        glm::vec3 p = c + (d - c) * hot.travelT[i];
+        grid.update(i, glm::vec2(p.x, p.z));
+    }
+}
+
+void FleetLogic::stepRange(int begin, int end, uint64_t firstTick, int ticks, float dt,
+    std::vector<int32_t>& arrived, std::vector<StopVisit>& visits)
+{
+    arrived.reserve(end - begin);
+
+    for (int k = 0; k < ticks; k++)
+    {
+        advance(begin, end, dt, arrived);
+
+        // Very short segments can be crossed more than once per tick.
+        for (int32_t bus : arrived)
+        {
+            do arriveAtPoint(bus, firstTick + (uint64_t)k + 1, dt, visits);
+            while (hot.travelT[bus] >= 1.0f);
+        }
+    }
+}
+
+// Branch-free over the hot arrays so the compiler can vectorize it; buses
+// that crossed a route point are collected and handled on the cold path.
+void FleetLogic::advance(int begin, int end, float dt, std::vector<int32_t>& arrived)
+{
+    float* travelT = hot.travelT.data();
+    const float* travelRate = hot.travelRate.data();
+    float* dwellLeft = hot.dwellLeft.data();
+
+    for (int i = begin; i < end; i++)
+    {
+        // A dwell ending inside the tick leaves the rest of it for driving.
+        float dwell = dwellLeft[i];
+        float moveTime = std::max(dt - dwell, 0.0f);
+
+        travelT[i] += moveTime * travelRate[i];
+        dwellLeft[i] = std::max(dwell - dt, 0.0f);
+    }
+
+    arrived.clear();
+    for (int i = begin; i < end; i++)
+    {
+        if (travelT[i] >= 1.0f)
+            arrived.push_back(i);
+    }
+}
+
+void FleetLogic::arriveAtPoint(int bus, uint64_t atTick, float dt, std::vector<StopVisit>& visits)
+{
+    int point = (cold.currentRoutePoint[bus] + 1) % ROUTE_POINT_COUNT;
+    cold.currentRoutePoint[bus] = point;
+    if (point == 0) cold.lapsCompleted[bus]++;
+
+    // Time driven past the point since reaching it, as BusLogic::update
+    // carries it: into the next segment, or off the dwell at a stop.
+    float overshoot = (hot.travelT[bus] - 1.0f) / hot.travelRate[bus];
+    hot.travelRate[bus] = segmentRate[point];
+
+    if (!IsStopPoint(point))
+    {
+        hot.travelT[bus] = overshoot * hot.travelRate[bus];
+        return;
+    }
+
+    hot.travelT[bus] = 0.0f;
+    hot.dwellLeft[bus] = std::max((float)STOP_DWELL_TIME - overshoot, 0.0f);
+    cold.stopsVisited[bus]++;
+
+    const uint32_t stream = (uint32_t)bus;
+    int passengers = cold.passengers[bus];
+
+    if (cold.controlInside[bus])
+    {
+        int passengerOnly = std::max(0, passengers - 1);
+        cold.totalFines[bus] += DrawFines(SimRandom(rngSeed, stream, atTick, RandomLane::Fine), passengerOnly);
+
+        passengers = std::max(0, passengers - 1);
+        cold.controlInside[bus] = 0;
+    }
+
+    // With agents or demand, riders get on and off when the batch ends; the
+    // inspector draw below sees the load the bus arrived with.
+    if (!policy.agents && !policy.demand)
+    {
+        passengers -= SimRandomBelow(SimRandom(rngSeed, stream, atTick, RandomLane::Alight), passengers + 1);
+
+        int room = BUS_CAPACITY - passengers;
+        passengers += SimRandomBelow(SimRandom(rngSeed, stream, atTick, RandomLane::Board), std::min(room, policy.maxBoarding) + 1);
+    }
+
+    if (passengers < BUS_CAPACITY &&
+        SimRandomBelow(SimRandom(rngSeed, stream, atTick, RandomLane::Inspection), 100) < policy.inspectionPercent)
+    {
+        cold.controlInside[bus] = 1;
+        passengers++;
+    }
+
+    cold.passengers[bus] = passengers;
+
+    if (policy.agents || policy.demand)
+    {
+        StopVisit v;
+        v.time = (double)atTick * dt;
+        v.bus = (uint32_t)bus;
+        v.stop = (uint16_t)StopNumberForRouteIdx(point);
+        v.line = (uint8_t)lineOf(bus);
+        v.room = BUS_CAPACITY - passengers;
+        v.key = ((uint64_t)SimRandom(rngSeed, stream, atTick, RandomLane::Demand) << 32) ^ atTick;
+        visits.push_back(v);
+    }
+}
+
+void FleetLogic::visitStopWithDemand(StopVisit& v)
+{
+    StopDemandResult r = policy.demand->visitStop(v.stop, stopLastVisit[v.stop], v.time, v.room, v.key,
+        &cold.ridersTo[(size_t)v.bus * STOP_COUNT], stopWaiting[v.stop]);
+    stopLastVisit[v.stop] = v.time;
+
+    v.alighted = r.alighted;
+    v.boarded = r.boarded;
+    v.denied = r.denied;
+}
+
+glm::vec3 FleetLogic::busPosition(int bus) const
+{
+    return PositionAtDistance(busDistance(bus));
+}
+
+double FleetLogic::busDistance(int bus) const
+{
+    return DistanceAtPosition(cold.currentRoutePoint[bus], hot.travelT[bus]);
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "SpatialIndex.h"
+#include "AgentStore.h"
+
+class PassengerDemand;
+
+// Per-bus state touched on every tick, one array per field.
+struct FleetHot
+{
+    std::vector<float> travelT;
+    std::vector<float> travelRate;   // BUS_WORLD_SPEED / length of the current segment
+    std::vector<float> dwellLeft;    // > 0 while the bus stands at a stop
+};
+
+// Per-bus state touched only when a bus reaches a route point.
+struct FleetCold
+{
+    std::vector<int32_t> currentRoutePoint;
+    std::vector<int32_t> stopsVisited;
+    std::vector<int32_t> lapsCompleted;
+
+    std::vector<int32_t> passengers;
+    std::vector<uint8_t> controlInside;
+    std::vector<int32_t> totalFines;
+
+    // Only filled when FleetPolicy::demand is set; per bus, STOP_COUNT wide.
+    std::vector<int32_t> ridersTo;
+
+    std::vector<int64_t> boarded;
+    std::vector<int64_t> alighted;
+    std::vector<int64_t> denied;
+};
+
+struct FleetPolicy
+{
+    int inspectionPercent = 10;   // chance an inspector boards at a stop
+    int maxBoarding = 8;          // riders boarding per stop are drawn from [0, maxBoarding]
+
+    // Replaces the uniform boarding/alighting draws above when set; must
+    // be set before reset() and outlive the fleet.
+    const PassengerDemand* demand = nullptr;
+
+    // Individual riders instead of either of the above; same rules. Bus b
+    // runs line b % lineCount.
+    AgentStore* agents = nullptr;
+    int lineCount = 1;
+};
+
+class FleetLogic
+{
+public:
+    void reset(int busCount, uint64_t seed = 1);
+    void update(double dt);
+
+    // Advances every bus by `ticks` fixed steps. Buses never interact, so each
+    // worker owns a contiguous block of buses for the whole batch and all
+    // random draws are keyed by (bus, tick): results are identical for any
+    // thread count. With a demand model or agents, riders waiting at a stop
+    // are shared by every bus calling there: boarding waits for the end of a
+    // batch no longer than a stop dwell (the bus is still at the stop), and
+    // each batch's stop visits are worked through stop by stop.
+    void step(int64_t ticks, double dt, int threadCount);
+
+    int lineOf(int bus) const { return bus % std::max(1, policy.lineCount); }
+
+    int size() const { return (int)hot.travelT.size(); }
+    uint64_t ticks() const { return tick; }
+
+    bool atStop(int bus) const { return hot.dwellLeft[bus] > 0.0f; }
+    glm::vec3 busPosition(int bus) const;
+    double busDistance(int bus) const;
+
+    // Bus positions on the ground plane (x, z), refreshed after every step.
+    const BusGrid& busGrid() const { return grid; }
+
+    const FleetHot& hotState() const { return hot; }
+    const FleetCold& coldState() const { return cold; }
+
+    FleetPolicy policy;
+
+private:
+    FleetHot hot;
+    FleetCold cold;
+
+    uint64_t rngSeed = 1;
+    uint64_t tick = 0;
+
+    std::vector<float> segmentRate;
+    BusGrid grid;
+
+    // Demand model riders waiting at each stop, shared by all buses.
+    std::vector<int32_t> stopWaiting;
+    std::vector<double> stopLastVisit;
+
+    void stepTicks(int ticks, double dt, int threadCount, std::vector<StopVisit>& visits);
+    void stepRange(int begin, int end, uint64_t firstTick, int ticks, float dt,
+        std::vector<int32_t>& arrived, std::vector<StopVisit>& visits);
+    void advance(int begin, int end, float dt, std::vector<int32_t>& arrived);
+    void arriveAtPoint(int bus, uint64_t atTick, float dt, std::vector<StopVisit>& visits);
+    void applyStopVisits(std::vector<StopVisit>& visits, int threadCount);
+    void visitStopWithDemand(StopVisit& v);
+    void updateGrid();
+};
@@ -0,0 +1,512 @@
+#include "GtfsImport.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <initializer_list>
+#include <thread>
+#include <unordered_map>
+
+namespace
+{
+    struct Field
+    {
+        const char* p = nullptr;
+        uint32_t n = 0;
+        bool escaped = false;   // quoted and holds "" for a literal quote
+
+        bool empty() const { return n == 0; }
+
+        std::string str() const
+        {
+            if (!escaped) return std::string(p, n);
+
+            std::string s;
+            s.reserve(n);
+            for (uint32_t i = 0; i < n; i++)
+            {
+                s += p[i];
+                if (p[i] == '"' && i + 1 < n && p[i + 1] == '"') i++;
+            }
+            return s;
+        }
+    };
+
+    struct FieldHash
+    {
+        size_t operator()(const Field& f) const
+        {
+            uint64_t h = 1469598103934665603ull;
+            for (uint32_t i = 0; i < f.n; i++) h = (h ^ (uint8_t)f.p[i]) * 1099511628211ull;
+            return (size_t)h;
+        }
+    };
+
+    struct FieldEq
+    {
+        bool operator()(const Field& a, const Field& b) const
+        {
+            return a.n == b.n && memcmp(a.p, b.p, a.n) == 0;
+        }
+    };
+
+    // Keys point into the mapped files, which stay open for the whole import.
+    template <typename V>
+    using FieldMap = std::unordered_map<Field, V, FieldHash, FieldEq>;
+
+    constexpr int MAX_FIELDS = 32;
+    constexpr double METRES_PER_DEGREE = 111319.49;
+
+    // Snapping a stop gives up this far (metres along the shape) past the
+    // closest point found so far.
+    constexpr float SNAP_LOOKAHEAD = 1000.0f;
+
+    // Splits one line (without its line break) into fields; quotes around a
+    // field are dropped and "" inside them stands for one quote.
+    int SplitRow(const char* p, const char* end, Field* out)
+    {
+        int count = 0;
+        while (count < MAX_FIELDS)
+        {
+            Field& f = out[count++];
+            if (p < end && *p == '"')
+            {
+                // "" inside quotes is a literal quote, not the closing one.
+                f.escaped = false;
+                const char* q = p + 1;
+                for (;;)
+                {
+                    q = (const char*)memchr(q, '"', end - q);
+                    if (!q) { q = end; break; }
+                    if (q + 1 < end && q[1] == '"') { f.escaped = true; q += 2; continue; }
+                    break;
+                }
+                f.p = p + 1;
+                f.n = (uint32_t)(q - p - 1);
+                p = (q < end) ? q + 1 : end;
+                const char* comma = (const char*)memchr(p, ',', end - p);
+                if (!comma) break;
+                p = comma + 1;
+            }
+            else
+            {
+                const char* comma = (const char*)memchr(p, ',', end - p);
+                const char* e = comma ? comma : end;
+                f.p = p;
+                f.n = (uint32_t)(e - p);
+                f.escaped = false;
+                if (!comma) break;
+                p = comma + 1;
+            }
+        }
+        return count;
+    }
+
+    double ParseDouble(const Field& f)
+    {
+        const char* p = f.p;
+        const char* e = f.p + f.n;
+        while (p < e && *p == ' ') p++;
+
+        bool neg = false;
+        if (p < e && (*p == '-' || *p == '+')) neg = (*p++ == '-');
+
+        double v = 0.0;
+        while (p < e && *p >= '0' && *p <= '9') v = v * 10.0 + (*p++ - '0');
+        if (p < e && *p == '.')
+        {
+            p++;
+            double scale = 0.1;
+            while (p < e && *p >= '0' && *p <= '9')
+            {
+                v += (*p++ - '0') * scale;
+                scale *= 0.1;
+            }
+        }
+        if (p < e && (*p == 'e' || *p == 'E'))
+            v *= std::pow(10.0, (double)atoi(std::string(p + 1, e).c_str()));
+
+        return neg ? -v : v;
+    }
+
+    int ParseInt(const Field& f)
+    {
+        const char* p = f.p;
+        const char* e = f.p + f.n;
+        while (p < e && *p == ' ') p++;
+
+        int v = 0;
+        while (p < e && *p >= '0' && *p <= '9') v = v * 10 + (*p++ - '0');
+        return v;
+    }
+
+    class CsvTable
+    {
+    public:
+        bool open(const std::string& path)
+        {
+            if (!file.open(path.c_str())) return false;
+
+            const char* p = (const char*)file.data();
+            end = p + file.size();
+            if (file.size() >= 3 && memcmp(p, "\xEF\xBB\xBF", 3) == 0) p += 3;
+
+            const char* nl = (const char*)memchr(p, '\n', end - p);
+            const char* lineEnd = nl ? nl : end;
+            if (lineEnd > p && lineEnd[-1] == '\r') lineEnd--;
+
+            Field fields[MAX_FIELDS];
+            int n = SplitRow(p, lineEnd, fields);
+            for (int i = 0; i < n; i++)
+            {
+                Field f = fields[i];
+                while (f.n > 0 && f.p[0] == ' ') { f.p++; f.n--; }
+                while (f.n > 0 && f.p[f.n - 1] == ' ') f.n--;
+                columns.push_back(f.str());
+            }
+
+            body = nl ? nl + 1 : end;
+            return true;
+        }
+
+        int column(const char* name) const
+        {
+            for (size_t i = 0; i < columns.size(); i++)
+                if (columns[i] == name) return (int)i;
+            return -1;
+        }
+
+        const char* body = nullptr;
+        const char* end = nullptr;
+
+    private:
+        MappedFile file;
+        std::vector<std::string> columns;
+    };
+
+    // Parses the table in chunks on several threads. `parse(fields, count,
+    // row)` returns false to skip a line. Rows come back in file order.
+    template <typename Row, typename F>
+    std::vector<Row> ParseTable(const CsvTable& t, int threadCount, long long& lines, F parse)
+    {
+        const size_t size = (size_t)(t.end - t.body);
+        const int chunkCount = std::max(1, std::min(threadCount * 4, (int)(size / 4096) + 1));
+
+        std::vector<const char*> bounds(chunkCount + 1);
+        bounds[0] = t.body;
+        bounds[chunkCount] = t.end;
+        for (int c = 1; c < chunkCount; c++)
+        {
+            const char* at = std::max(bounds[c - 1], t.body + size * c / chunkCount);
+            const char* nl = (const char*)memchr(at, '\n', t.end - at);
+            bounds[c] = nl ? nl + 1 : t.end;
+        }
+
+        std::vector<std::vector<Row>> parts(chunkCount);
+        std::vector<long long> partLines(chunkCount, 0);
+        std::atomic<int> nextChunk(0);
+
+        auto work = [&]()
+            {
+                Field fields[MAX_FIELDS];
+                for (int c = nextChunk++; c < chunkCount; c = nextChunk++)
+                {
+                    std::vector<Row>& out = parts[c];
+                    const char* p = bounds[c];
+                    const char* e = bounds[c + 1];
+                    long long n = 0;
+
+                    while (p < e)
+                    {
+                        const char* nl = (const char*)memchr(p, '\n', e - p);
+                        const char* lineEnd = nl ? nl : e;
+                        const char* next = nl ? nl + 1 : e;
+                        if (lineEnd > p && lineEnd[-1] == '\r') lineEnd--;
+
+                        if (lineEnd > p)
+                        {
+                            n++;
+                            Row r;
+                            int count = SplitRow(p, lineEnd, fields);
+                            if (parse(fields, count, r)) out.push_back(r);
+                        }
+                        p = next;
+                    }
+                    partLines[c] = n;
+                }
+            };
+
+        threadCount = std::max(1, std::min(threadCount, chunkCount));
+        std::vector<std::thread> workers;
+        for (int i = 1; i < threadCount; i++) workers.emplace_back(work);
+        work();
+        for (auto& w : workers) w.join();
+
+        size_t total = 0;
+        for (const auto& part : parts) total += part.size();
+
+        std::vector<Row> rows;
+        rows.reserve(total);
+        lines = 0;
+        for (int c = 0; c < chunkCount; c++)
+        {
+            rows.insert(rows.end(), parts[c].begin(), parts[c].end());
+            lines += partLines[c];
+        }
+        return rows;
+    }
+
+    template <typename F>
+    void ParallelFor(int count, int threadCount, F f)
+    {
+        std::atomic<int> next(0);
+        auto work = [&]()
+            {
+                for (int i = next++; i < count; i = next++) f(i);
+            };
+
+        threadCount = std::max(1, std::min(threadCount, count));
+        std::vector<std::thread> workers;
+        for (int i = 1; i < threadCount; i++) workers.emplace_back(work);
+        work();
+        for (auto& w : workers) w.join();
+    }
+
+    struct StopRow { Field id; double lat; double lon; };
+    struct TripRow { Field trip; Field route; Field shape; };
+    struct StopTimeRow { int32_t route; int32_t sequence; int32_t stop; };
+    struct ShapeRow { int32_t route; int32_t sequence; double lat; double lon; };
+
+    // Per output route: the trip whose stop pattern it takes.
+    struct RoutePlan
+    {
+        Field route;
+        Field shape;
+    };
+
+    bool ColumnsPresent(const CsvTable& t, std::initializer_list<const char*> names, const char* file, std::string& error)
+    {
+        for (const char* name : names)
+        {
+            if (t.column(name) < 0)
+            {
+                error = std::string(file) + ": missing column " + name;
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+bool ImportGtfs(const char* feedDir, int threadCount, std::vector<RouteSource>& routes,
+    GtfsImportStats& stats, std::string& error)
+{
+    auto wallStart = std::chrono::steady_clock::now();
+    stats = GtfsImportStats{};
+    routes.clear();
+
+    const std::string dir = std::string(feedDir) + "/";
+    CsvTable stopsTable, tripsTable, stopTimesTable, shapesTable;
+    if (!stopsTable.open(dir + "stops.txt")) { error = "cannot open stops.txt"; return false; }
+    if (!tripsTable.open(dir + "trips.txt")) { error = "cannot open trips.txt"; return false; }
+    if (!stopTimesTable.open(dir + "stop_times.txt")) { error = "cannot open stop_times.txt"; return false; }
+    bool haveShapes = shapesTable.open(dir + "shapes.txt");
+
+    if (!ColumnsPresent(stopsTable, { "stop_id", "stop_lat", "stop_lon" }, "stops.txt", error)) return false;
+    if (!ColumnsPresent(tripsTable, { "trip_id", "route_id" }, "trips.txt", error)) return false;
+    if (!ColumnsPresent(stopTimesTable, { "trip_id", "stop_id", "stop_sequence" }, "stop_times.txt", error)) return false;
+    if (haveShapes && !ColumnsPresent(shapesTable, { "shape_id", "shape_pt_lat", "shape_pt_lon", "shape_pt_sequence" }, "shapes.txt", error))
+        return false;
+
+    // Stops.
+    const int cStopId = stopsTable.column("stop_id");
+    const int cStopLat = stopsTable.column("stop_lat");
+    const int cStopLon = stopsTable.column("stop_lon");
+    std::vector<StopRow> stops = ParseTable<StopRow>(stopsTable, threadCount, stats.stopRows,
+        [&](const Field* f, int n, StopRow& r)
+        {
+            if (n <= std::max(cStopId, std::max(cStopLat, cStopLon))) return false;
+            r.id = f[cStopId];
+            r.lat = ParseDouble(f[cStopLat]);
+            r.lon = ParseDouble(f[cStopLon]);
+            return true;
+        });
+    if (stops.empty()) { error = "stops.txt has no stops"; return false; }
+
+    FieldMap<int32_t> stopIndex;
+    stopIndex.reserve(stops.size());
+    double lat0 = 0.0, lon0 = 0.0;
+    for (size_t i = 0; i < stops.size(); i++)
+    {
+        stopIndex.emplace(stops[i].id, (int32_t)i);
+        lat0 += stops[i].lat;
+        lon0 += stops[i].lon;
+    }
+    lat0 /= (double)stops.size();
+    lon0 /= (double)stops.size();
+
+    const double xScale = std::cos(lat0 * 3.14159265358979323846 / 180.0) * METRES_PER_DEGREE;
+    auto project = [&](double lat, double lon)
+        {
+            return glm::vec2((float)((lon - lon0) * xScale), (float)((lat - lat0) * METRES_PER_DEGREE));
+        };
+
+    // Trips: one route per shape, or per line for trips without a shape.
+    const int cTrip = tripsTable.column("trip_id");
+    const int cRoute = tripsTable.column("route_id");
+    const int cShape = tripsTable.column("shape_id");
+    std::vector<TripRow> trips = ParseTable<TripRow>(tripsTable, threadCount, stats.tripRows,
+        [&](const Field* f, int n, TripRow& r)
+        {
+            if (n <= std::max(cTrip, cRoute)) return false;
+            r.trip = f[cTrip];
+            r.route = f[cRoute];
+            r.shape = (cShape >= 0 && cShape < n) ? f[cShape] : Field();
+            return true;
+        });
+
+    std::vector<RoutePlan> plans;
+    FieldMap<int32_t> routeOfShape, routeOfLine, routeOfTrip;
+    for (const TripRow& t : trips)
+    {
+        FieldMap<int32_t>& byKey = (haveShapes && !t.shape.empty()) ? routeOfShape : routeOfLine;
+        const Field& key = (haveShapes && !t.shape.empty()) ? t.shape : t.route;
+        if (byKey.count(key)) continue;
+
+        byKey.emplace(key, (int32_t)plans.size());
+        routeOfTrip.emplace(t.trip, (int32_t)plans.size());
+        plans.push_back({ t.route, (haveShapes ? t.shape : Field()) });
+    }
+
+    // Stop times: by far the largest file; only rows of the chosen trips
+    // are kept, everything else is dropped right in the chunk parser.
+    const int cStTrip = stopTimesTable.column("trip_id");
+    const int cStStop = stopTimesTable.column("stop_id");
+    const int cStSeq = stopTimesTable.column("stop_sequence");
+    const int stNeeded = std::max(cStTrip, std::max(cStStop, cStSeq));
+    std::vector<StopTimeRow> stopTimes = ParseTable<StopTimeRow>(stopTimesTable, threadCount, stats.stopTimeRows,
+        [&](const Field* f, int n, StopTimeRow& r)
+        {
+            if (n <= stNeeded) return false;
+            auto trip = routeOfTrip.find(f[cStTrip]);
+            if (trip == routeOfTrip.end()) return false;
+            auto stop = stopIndex.find(f[cStStop]);
+            if (stop == stopIndex.end()) return false;
+
+            r.route = trip->second;
+            r.sequence = ParseInt(f[cStSeq]);
+            r.stop = stop->second;
+            return true;
+        });
+    stats.stopTimesUsed = (long long)stopTimes.size();
+
+    std::vector<ShapeRow> shapes;
+    if (haveShapes)
+    {
+        const int cShId = shapesTable.column("shape_id");
+        const int cShLat = shapesTable.column("shape_pt_lat");
+        const int cShLon = shapesTable.column("shape_pt_lon");
+        const int cShSeq = shapesTable.column("shape_pt_sequence");
+        const int shNeeded = std::max(std::max(cShId, cShLat), std::max(cShLon, cShSeq));
+        shapes = ParseTable<ShapeRow>(shapesTable, threadCount, stats.shapeRows,
+            [&](const Field* f, int n, ShapeRow& r)
+            {
+                if (n <= shNeeded) return false;
+                auto it = routeOfShape.find(f[cShId]);
+                if (it == routeOfShape.end()) return false;
+
+                r.route = it->second;
+                r.sequence = ParseInt(f[cShSeq]);
+                r.lat = ParseDouble(f[cShLat]);
+                r.lon = ParseDouble(f[cShLon]);
+                return true;
+            });
+    }
+
+    auto byRouteThenSequence = [](const auto& a, const auto& b)
+        {
+            return a.route != b.route ? a.route < b.route : a.sequence < b.sequence;
+        };
+    if (!std::is_sorted(stopTimes.begin(), stopTimes.end(), byRouteThenSequence))
+        std::sort(stopTimes.begin(), stopTimes.end(), byRouteThenSequence);
+    if (!std::is_sorted(shapes.begin(), shapes.end(), byRouteThenSequence))
+        std::sort(shapes.begin(), shapes.end(), byRouteThenSequence);
+
+    const int routeCount = (int)plans.size();
+    std::vector<size_t> stopBegin(routeCount + 1, 0), shapeBegin(routeCount + 1, 0);
+    for (const StopTimeRow& r : stopTimes) stopBegin[r.route + 1]++;
+    for (const ShapeRow& r : shapes) shapeBegin[r.route + 1]++;
+    for (int i = 0; i < routeCount; i++)
+    {
+        stopBegin[i + 1] += stopBegin[i];
+        shapeBegin[i + 1] += shapeBegin[i];
+    }
+
+    routes.resize(routeCount);
+    std::atomic<int> withoutShape(0);
+    std::atomic<long long> stopsPastShape(0);
+    ParallelFor(routeCount, threadCount, [&](int i)
+        {
+            RouteSource& src = routes[i];
+            src.closed = false;
+            src.name = plans[i].route.str();
+            if (!plans[i].shape.empty()) src.name += "/" + plans[i].shape.str();
+
+            std::vector<glm::vec2> stopPos;
+            for (size_t k = stopBegin[i]; k < stopBegin[i + 1]; k++)
+            {
+                const StopRow& s = stops[stopTimes[k].stop];
+                stopPos.push_back(project(s.lat, s.lon));
+            }
+
+            if (shapeBegin[i + 1] - shapeBegin[i] < 2)
+            {
+                withoutShape++;
+                src.points = stopPos;
+                for (size_t k = 0; k < stopPos.size(); k++) src.stops.push_back((int)k);
+                return;
+            }
+
+            for (size_t k = shapeBegin[i]; k < shapeBegin[i + 1]; k++)
+                src.points.push_back(project(shapes[k].lat, shapes[k].lon));
+
+            // Each stop goes to the nearest shape point after the previous
+            // stop's, so stops stay in driving order even where a shape
+            // passes the same place twice. Stops left over when the shape
+            // runs out extend the route with points of their own.
+            int from = 0;
+            const int pointCount = (int)src.points.size();
+            for (const glm::vec2& p : stopPos)
+            {
+                if (from >= (int)src.points.size())
+                {
+                    src.points.push_back(p);
+                    src.stops.push_back(from++);
+                    stopsPastShape++;
+                    continue;
+                }
+
+                int best = from;
+                float bestDist = glm::dot(src.points[from] - p, src.points[from] - p);
+                float sinceBest = 0.0f;
+                for (int k = from + 1; k < pointCount; k++)
+                {
+                    glm::vec2 d = src.points[k] - p;
+                    float dist = glm::dot(d, d);
+                    sinceBest += glm::length(src.points[k] - src.points[k - 1]);
+                    if (dist < bestDist) { bestDist = dist; best = k; sinceBest = 0.0f; }
+                    else if (sinceBest > std::max(SNAP_LOOKAHEAD, 4.0f * std::sqrt(bestDist))) break;
+                }
+                src.stops.push_back(best);
+                from = best + 1;
+            }
+        });
+
+    stats.routes = routeCount;
+    stats.routesWithoutShape = withoutShape.load();
+    stats.stopsPastShape = stopsPastShape.load();
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "RouteNetwork.h"
+
+struct GtfsImportStats
+{
+    long long stopRows = 0;
+    long long tripRows = 0;
+    long long shapeRows = 0;
+    long long stopTimeRows = 0;
+    long long stopTimesUsed = 0;
+
+    int routes = 0;
+    int routesWithoutShape = 0;
+    long long stopsPastShape = 0;   // stops after the end of their shape, added as extra points
+    double seconds = 0.0;
+};
+
+// Reads an unpacked GTFS feed (stops.txt, trips.txt, stop_times.txt and,
+// if present, shapes.txt) into one open route per shape. Every CSV is
+// mapped and split into chunks at line breaks that are parsed on
+// `threadCount` threads. Positions are projected to metres around the
+// feed centre. Each shape takes the stop pattern of its first trip, with
+// stops snapped forward along the shape; a trip without a shape becomes a
+// route through its stops.
+//
+// Quoted fields may contain commas but not line breaks.
+//
+// The routes go into a RouteNetwork file for Headless --network queries.
+// BusLogic and FleetLogic do not read networks; they still drive the
+// compiled-in route (RouteData.h).
+bool ImportGtfs(const char* feedDir, int threadCount, std::vector<RouteSource>& routes,
+    GtfsImportStats& stats, std::string& error);
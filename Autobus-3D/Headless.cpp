@@ -0,0 +1,988 @@
+// Nikola Gligoric RA6/2022 - Autobus 3D (headless simulation runner)
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+
+#include "ActorAnimKernel.h"
+#include "BusLogic.h"
+#include "BusSnapshot.h"
+#include "EventSim.h"
+#include "FineEstimator.h"
+#include "FleetLogic.h"
+#include "GtfsImport.h"
+#include "InputRecording.h"
+#include "PassengerDemand.h"
+#include "AgentStore.h"
+#include "BoardingScript.h"
+#include "RewindBuffer.h"
+#include "RouteData.h"
+#include "RouteNetwork.h"
+#include "SpatialIndex.h"
+#include "SimRandom.h"
+
+static constexpr size_t REWIND_CAPACITY = 16 * 1024 * 1024;
+static constexpr int REWIND_KEYFRAME_INTERVAL = 150;
+
+struct ScriptEvent
+{
+    double time = 0.0;
+    SimCommand cmd = SimCommand::PassengerEnter;
+};
+
+struct RunConfig
+{
+    double seconds = 24.0 * 60.0 * 60.0;
+    double dt = 1.0 / 75.0;
+    unsigned int seed = 1;
+    int fleetSize = 0;
+    int threads = 1;
+    int eventBuses = 0;
+    int animActors = 0;
+    int scriptRiders = 0;
+    float demandRate = 0.0f;
+    std::string snapshotIn;
+    std::string snapshotOut;
+    int forks = 0;
+    std::string replayPath;
+    double rewindSeconds = 0.0;
+    long long fineShifts = 0;
+    int inspectionPercent = 10;
+    std::string networkIn;
+    std::string networkOut;
+    std::string gtfsDir;
+    int synthRoutes = 0;
+    int synthPoints = 1000;
+    int spatialQueries = 0;
+    bool smoothPath = false;
+    bool agents = false;
+    int lineCount = 1;
+    int transferPercent = 0;
+    std::string scriptPath;
+};
+
+struct RunStats
+{
+    long long steps = 0;
+    long long accepted = 0;
+    long long rejected = 0;
+    long long stopsVisited = 0;
+};
+
+static bool ParseCommand(const std::string& word, SimCommand& out)
+{
+    if (word == "enter")   { out = SimCommand::PassengerEnter; return true; }
+    if (word == "exit")    { out = SimCommand::PassengerExit;  return true; }
+    if (word == "control") { out = SimCommand::ControlEnter;   return true; }
+    return false;
+}
+
+// Script format: one "<time> <enter|exit|control>" pair per line, '#' starts a comment.
+static bool LoadScript(const std::string& path, std::vector<ScriptEvent>& out)
+{
+    std::ifstream in(path);
+    if (!in) return false;
+
+    std::string line;
+    int lineNo = 0;
+    while (std::getline(in, line))
+    {
+        lineNo++;
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line.erase(hash);
+
+        std::istringstream ls(line);
+        ScriptEvent e;
+        std::string word;
+        if (!(ls >> e.time)) continue;
+        if (!(ls >> word) || !ParseCommand(word, e.cmd))
+        {
+            std::cerr << path << ":" << lineNo << ": unknown command" << std::endl;
+            return false;
+        }
+        out.push_back(e);
+    }
+
+    std::stable_sort(out.begin(), out.end(),
+        [](const ScriptEvent& a, const ScriptEvent& b) { return a.time < b.time; });
+    return true;
+}
+
+// Without a script, riders keep trying to board and alight every few seconds
+// and a ticket inspector tries to get on roughly once per lap.
+static std::vector<ScriptEvent> DefaultScript(double seconds)
+{
+    std::vector<ScriptEvent> out;
+    for (double t = 0.5; t < seconds; t += 2.0)
+        out.push_back({ t, SimCommand::PassengerEnter });
+    for (double t = 1.3; t < seconds; t += 3.0)
+        out.push_back({ t, SimCommand::PassengerExit });
+    for (double t = 7.0; t < seconds; t += 90.0)
+        out.push_back({ t, SimCommand::ControlEnter });
+
+    std::stable_sort(out.begin(), out.end(),
+        [](const ScriptEvent& a, const ScriptEvent& b) { return a.time < b.time; });
+    return out;
+}
+
+static void PrintUsage()
+{
+    std::cout << "usage: Headless [--seconds S] [--dt DT] [--seed N] [--script FILE] [--fleet BUSES [--threads N]] [--events BUSES] [--anim-bench ACTORS] [--script-bench RIDERS] [--demand PEAK_RIDERS_PER_HOUR]"
+        " [--snapshot-in FILE] [--snapshot-out FILE] [--forks N] [--replay FILE] [--rewind SECONDS]"
+        " [--fine-estimate SHIFTS [--inspection PERCENT] [--threads N]]"
+        " [--spatial QUERIES] [--smooth] [--agents [--lines N] [--transfers PERCENT]]"
+        " [--network-out FILE [--synth-routes N] [--synth-points P] | --gtfs DIR [--threads N]] [--network FILE]" << std::endl;
+}
+
+static bool ParseArgs(int argc, char** argv, RunConfig& cfg)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char* a = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if (!strcmp(a, "--seconds") && hasValue) cfg.seconds = atof(argv[++i]);
+        else if (!strcmp(a, "--dt") && hasValue) cfg.dt = atof(argv[++i]);
+        else if (!strcmp(a, "--seed") && hasValue) cfg.seed = (unsigned)strtoul(argv[++i], nullptr, 10);
+        else if (!strcmp(a, "--script") && hasValue) cfg.scriptPath = argv[++i];
+        else if (!strcmp(a, "--fleet") && hasValue) cfg.fleetSize = atoi(argv[++i]);
+        else if (!strcmp(a, "--threads") && hasValue) cfg.threads = atoi(argv[++i]);
+        else if (!strcmp(a, "--events") && hasValue) cfg.eventBuses = atoi(argv[++i]);
+        else if (!strcmp(a, "--anim-bench") && hasValue) cfg.animActors = atoi(argv[++i]);
+        else if (!strcmp(a, "--script-bench") && hasValue) cfg.scriptRiders = atoi(argv[++i]);
+        else if (!strcmp(a, "--demand") && hasValue) cfg.demandRate = (float)atof(argv[++i]);
+        else if (!strcmp(a, "--snapshot-in") && hasValue) cfg.snapshotIn = argv[++i];
+        else if (!strcmp(a, "--snapshot-out") && hasValue) cfg.snapshotOut = argv[++i];
+        else if (!strcmp(a, "--forks") && hasValue) cfg.forks = atoi(argv[++i]);
+        else if (!strcmp(a, "--replay") && hasValue) cfg.replayPath = argv[++i];
+        else if (!strcmp(a, "--rewind") && hasValue) cfg.rewindSeconds = atof(argv[++i]);
+        else if (!strcmp(a, "--fine-estimate") && hasValue) cfg.fineShifts = atoll(argv[++i]);
+        else if (!strcmp(a, "--inspection") && hasValue) cfg.inspectionPercent = atoi(argv[++i]);
+        else if (!strcmp(a, "--network") && hasValue) cfg.networkIn = argv[++i];
+        else if (!strcmp(a, "--network-out") && hasValue) cfg.networkOut = argv[++i];
+        else if (!strcmp(a, "--gtfs") && hasValue) cfg.gtfsDir = argv[++i];
+        else if (!strcmp(a, "--spatial") && hasValue) cfg.spatialQueries = atoi(argv[++i]);
+        else if (!strcmp(a, "--synth-routes") && hasValue) cfg.synthRoutes = atoi(argv[++i]);
+        else if (!strcmp(a, "--synth-points") && hasValue) cfg.synthPoints = atoi(argv[++i]);
+        else if (!strcmp(a, "--smooth")) cfg.smoothPath = true;
+        else if (!strcmp(a, "--agents")) cfg.agents = true;
+        else if (!strcmp(a, "--lines") && hasValue) cfg.lineCount = atoi(argv[++i]);
+        else if (!strcmp(a, "--transfers") && hasValue) cfg.transferPercent = atoi(argv[++i]);
+        else return false;
+    }
+    return cfg.seconds > 0.0 && cfg.dt > 0.0 && cfg.fleetSize >= 0 && cfg.threads > 0 && cfg.eventBuses >= 0 && cfg.animActors >= 0 && cfg.scriptRiders >= 0 && cfg.demandRate >= 0.0f && cfg.forks >= 0 && cfg.rewindSeconds >= 0.0 && cfg.fineShifts >= 0
+        && cfg.inspectionPercent >= 0 && cfg.inspectionPercent <= 100 && cfg.synthRoutes >= 0 && cfg.synthPoints > 1 && cfg.spatialQueries >= 0
+        && cfg.lineCount >= 1 && cfg.lineCount <= 256 && cfg.transferPercent >= 0 && cfg.transferPercent <= 100
+        && (!cfg.agents || (cfg.fleetSize > 0 && cfg.demandRate > 0.0f));
+}
+
+static void PrintDemand(const DemandTotals& d, double wall)
+{
+    long long events = d.boarded + d.alighted;
+    std::cout << "riders boarded    : " << d.boarded << " (" << d.denied << " left behind)" << std::endl;
+    std::cout << "riders alighted   : " << d.alighted << std::endl;
+    std::cout << "rider events / s  : " << (wall > 0.0 ? (double)events / wall : 0.0) << std::endl;
+}
+
+static double MicrosPerQuery(std::chrono::steady_clock::time_point start, int queries)
+{
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return queries > 0 ? wall * 1e6 / queries : 0.0;
+}
+
+// Random radius and nearest queries against the bus grid, each checked
+// against a full scan.
+static void RunBusQueries(const RunConfig& cfg, const FleetLogic& fleet)
+{
+    const BusGrid& grid = fleet.busGrid();
+    const float radius = 0.5f;
+    const int n = cfg.spatialQueries;
+
+    std::vector<glm::vec2> points(n);
+    for (int i = 0; i < n; i++)
+    {
+        uint32_t h = SimRandom(cfg.seed, 1, (uint64_t)i, RandomLane::Alight);
+        points[i] = grid.position(SimRandomBelow(h, grid.size())) + glm::vec2(0.3f, -0.2f);
+    }
+
+    std::vector<int> hits;
+    long long found = 0;
+    auto rangeStart = std::chrono::steady_clock::now();
+    for (const glm::vec2& p : points)
+    {
+        grid.inRadius(p, radius, hits);
+        found += (long long)hits.size();
+    }
+    double rangeUs = MicrosPerQuery(rangeStart, n);
+
+    auto nearestStart = std::chrono::steady_clock::now();
+    long long nearestSum = 0;
+    for (const glm::vec2& p : points) nearestSum += grid.nearest(p, 1e30f);
+    double nearestUs = MicrosPerQuery(nearestStart, n);
+
+    int mismatches = 0;
+    for (int i = 0; i < std::min(n, 200); i++)
+    {
+        grid.inRadius(points[i], radius, hits);
+        long long expected = 0;
+        float bestDist = 1e30f;
+        for (int b = 0; b < grid.size(); b++)
+        {
+            float d = glm::length(grid.position(b) - points[i]);
+            if (d <= radius) expected++;
+            bestDist = std::min(bestDist, d);
+        }
+        int near = grid.nearest(points[i], 1e30f);
+        if (expected != (long long)hits.size() || glm::length(grid.position(near) - points[i]) != bestDist) mismatches++;
+    }
+
+    std::cout << "grid relinks      : " << grid.relinks() << std::endl;
+    std::cout << "buses in radius   : " << rangeUs << " us / query (" << (double)found / std::max(n, 1) << " hits avg)" << std::endl;
+    std::cout << "nearest bus       : " << nearestUs << " us / query (checksum " << nearestSum << ")" << std::endl;
+    std::cout << "full scan check   : " << mismatches << " mismatches" << std::endl;
+}
+
+// Nearest stop / segment queries over the network, checked against a full
+// scan on a sample.
+static void RunNetworkQueries(const RunConfig& cfg, const RouteNetwork& net)
+{
+    auto buildStart = std::chrono::steady_clock::now();
+    RouteSpatialIndex index;
+    index.build(net);
+    double buildWall = std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+
+    const GridLayout& g = index.layout();
+    const int n = cfg.spatialQueries;
+    std::vector<glm::vec2> points(n);
+    for (int i = 0; i < n; i++)
+    {
+        uint32_t h = SimRandom(cfg.seed, 2, (uint64_t)i, RandomLane::Alight);
+        RouteView v = net.route(SimRandomBelow(h, net.routeCount()));
+        points[i] = v.positionAtDistance(v.length * (double)(SimHash32(h) & 0xFFFF) / 65535.0)
+            + glm::vec2(g.cellSize * 0.37f, -g.cellSize * 0.21f);
+    }
+
+    StopHit stop;
+    SegmentHit seg;
+    double sum = 0.0;
+
+    auto stopStart = std::chrono::steady_clock::now();
+    for (const glm::vec2& p : points) if (index.nearestStop(p, 1e30f, stop)) sum += stop.distance;
+    double stopUs = MicrosPerQuery(stopStart, n);
+
+    auto segStart = std::chrono::steady_clock::now();
+    for (const glm::vec2& p : points) if (index.nearestSegment(p, 1e30f, seg)) sum += seg.distance;
+    double segUs = MicrosPerQuery(segStart, n);
+
+    int mismatches = 0;
+    for (int i = 0; i < std::min(n, 20); i++)
+    {
+        float bestStop = 1e30f, bestSeg = 1e30f;
+        for (int r = 0; r < net.routeCount(); r++)
+        {
+            RouteView v = net.route(r);
+            for (int k = 0; k < v.stopCount; k++)
+                bestStop = std::min(bestStop, glm::length(v.point((int)v.stops[k]) - points[i]));
+            for (int k = 0; k < v.segmentCount(); k++)
+            {
+                glm::vec2 a = v.point(k);
+                glm::vec2 ab = v.point((k + 1) % v.pointCount) - a;
+                float len2 = glm::dot(ab, ab);
+                float t = len2 > 0.0f ? std::min(std::max(glm::dot(points[i] - a, ab) / len2, 0.0f), 1.0f) : 0.0f;
+                bestSeg = std::min(bestSeg, glm::length(a + ab * t - points[i]));
+            }
+        }
+        index.nearestStop(points[i], 1e30f, stop);
+        index.nearestSegment(points[i], 1e30f, seg);
+        if (stop.distance != bestStop || seg.distance != bestSeg) mismatches++;
+    }
+
+    std::cout << "spatial index     : " << g.cols << " x " << g.rows << " cells of " << g.cellSize
+        << ", " << index.segmentEntries() << " segment entries, built in " << buildWall << " s" << std::endl;
+    std::cout << "nearest stop      : " << stopUs << " us / query" << std::endl;
+    std::cout << "nearest segment   : " << segUs << " us / query (checksum " << sum << ")" << std::endl;
+    std::cout << "full scan check   : " << mismatches << " mismatches" << std::endl;
+}
+
+static void PrintAgents(const AgentStore& store, const FleetLogic& fleet, double genWall)
+{
+    const AgentTotals& t = store.totals();
+    const FleetCold& cold = fleet.coldState();
+
+    size_t riding = 0, waiting = 0;
+    long long onBoard = 0;
+    for (int i = 0; i < fleet.size(); i++)
+    {
+        riding += store.ridingOn(i);
+        onBoard += cold.passengers[i] - cold.controlInside[i];
+    }
+    for (int s = 0; s < store.stopCount(); s++) waiting += store.waitingAt(s);
+
+    std::cout << "agents            : " << store.size() << " on " << store.lines() << " line(s), "
+        << store.bytesPerAgent() << " bytes each" << std::endl;
+    std::cout << "agent gen seconds : " << genWall << std::endl;
+    std::cout << "agents arrived    : " << t.arrived << " (" << t.transfers << " transfers)" << std::endl;
+    std::cout << "agents en route   : " << riding << " riding, " << waiting << " waiting, "
+        << store.notYetDeparted() << " not yet out" << std::endl;
+    std::cout << "mean journey s    : " << (t.arrived > 0 ? t.journeySeconds / (double)t.arrived : 0.0) << std::endl;
+    std::cout << "agent check       : " << (((long long)riding == onBoard) ? "ok" : "MISMATCH") << std::endl;
+}
+
+static int RunFleet(const RunConfig& cfg, const PassengerDemand* demand)
+{
+    FleetLogic fleet;
+    AgentStore store;
+    double genWall = 0.0;
+
+    if (cfg.agents)
+    {
+        AgentPlanConfig plan;
+        plan.lineCount = cfg.lineCount;
+        plan.transferPercent = cfg.transferPercent;
+
+        auto genStart = std::chrono::steady_clock::now();
+        store.generate(*demand, 0.0, cfg.seconds, plan, cfg.seed, cfg.threads);
+        genWall = std::chrono::duration<double>(std::chrono::steady_clock::now() - genStart).count();
+
+        fleet.policy.agents = &store;
+        fleet.policy.lineCount = cfg.lineCount;
+    }
+    else
+    {
+        fleet.policy.demand = demand;
+    }
+    fleet.reset(cfg.fleetSize, cfg.seed);
+
+    const long long steps = (long long)(cfg.seconds / cfg.dt);
+
+    auto wallStart = std::chrono::steady_clock::now();
+
+    fleet.step(steps, cfg.dt, cfg.threads);
+
+    auto wallEnd = std::chrono::steady_clock::now();
+    double wall = std::chrono::duration<double>(wallEnd - wallStart).count();
+    double simulated = (double)steps * cfg.dt;
+    double busSteps = (double)steps * (double)fleet.size();
+
+    const FleetCold& cold = fleet.coldState();
+    long long stopsVisited = 0;
+    long long fines = 0;
+    uint64_t checksum = 0;
+    for (int i = 0; i < fleet.size(); i++)
+    {
+        stopsVisited += cold.stopsVisited[i];
+        fines += cold.totalFines[i];
+
+        uint32_t bits = 0;
+        memcpy(&bits, &fleet.hotState().travelT[i], sizeof(bits));
+        checksum = SimMix64(checksum ^ bits ^ ((uint64_t)cold.passengers[i] << 32));
+    }
+
+    std::cout << "buses             : " << fleet.size() << " on " << cfg.threads << " thread(s)" << std::endl;
+    std::cout << "simulated seconds : " << simulated << std::endl;
+    std::cout << "wall seconds      : " << wall << std::endl;
+    std::cout << "sim s / wall s    : " << (wall > 0.0 ? simulated / wall : 0.0) << std::endl;
+    std::cout << "bus steps / wall s: " << (wall > 0.0 ? busSteps / wall : 0.0) << std::endl;
+    std::cout << "stops visited     : " << stopsVisited << std::endl;
+    std::cout << "total fines       : " << fines << std::endl;
+    std::cout << "state checksum    : " << std::hex << checksum << std::dec << std::endl;
+
+    if (demand)
+    {
+        DemandTotals d;
+        for (int i = 0; i < fleet.size(); i++)
+        {
+            d.boarded += cold.boarded[i];
+            d.alighted += cold.alighted[i];
+            d.denied += cold.denied[i];
+        }
+        PrintDemand(d, wall);
+    }
+
+    if (cfg.agents) PrintAgents(store, fleet, genWall);
+
+    if (cfg.spatialQueries > 0 && fleet.size() > 0) RunBusQueries(cfg, fleet);
+    return 0;
+}
+
+// Event mode has no fixed dt: buses jump from deadline to deadline and the
+// script (if any) is delivered to every bus at its exact timestamp.
+static int RunEvents(const RunConfig& cfg, const std::vector<ScriptEvent>& script)
+{
+    EventSim sim;
+    sim.reset(cfg.eventBuses, cfg.seed);
+
+    for (const ScriptEvent& e : script)
+    {
+        if (e.time > cfg.seconds) break;
+        for (int b = 0; b < sim.size(); b++)
+            sim.schedule(e.time, b, e.cmd);
+    }
+
+    auto wallStart = std::chrono::steady_clock::now();
+
+    sim.runUntil(cfg.seconds);
+
+    auto wallEnd = std::chrono::steady_clock::now();
+    double wall = std::chrono::duration<double>(wallEnd - wallStart).count();
+
+    long long fines = 0;
+    for (int b = 0; b < sim.size(); b++) fines += sim.bus(b).state().totalFines;
+
+    std::cout << "buses             : " << sim.size() << " (event driven)" << std::endl;
+    std::cout << "simulated seconds : " << cfg.seconds << std::endl;
+    std::cout << "wall seconds      : " << wall << std::endl;
+    std::cout << "sim s / wall s    : " << (wall > 0.0 ? cfg.seconds / wall : 0.0) << std::endl;
+    std::cout << "events processed  : " << sim.eventsProcessed() << std::endl;
+    std::cout << "commands accepted : " << sim.commandsAccepted() << std::endl;
+    std::cout << "total fines       : " << fines << std::endl;
+
+    return 0;
+}
+
+// Sim time after `steps` fixed steps from `start`. Counting whole steps
+// from the start of the run keeps a resumed run bit-identical to one that
+// never stopped.
+static double StepTime(double start, long long steps, double dt)
+{
+    long long first = (long long)std::llround(start / dt);
+    return (double)(first + steps) * dt;
+}
+
+static RunStats RunBus(BusLogic& logic, double startTime, const RunConfig& cfg, const std::vector<ScriptEvent>& script)
+{
+    RunStats stats;
+    size_t nextEvent = 0;
+    while (nextEvent < script.size() && script[nextEvent].time <= startTime) nextEvent++;
+
+    const uint64_t visitsBefore = logic.stopsVisited();
+    const long long steps = (long long)(cfg.seconds / cfg.dt);
+
+    for (long long step = 0; step < steps; step++)
+    {
+        double now = StepTime(startTime, step + 1, cfg.dt);
+        logic.update(now, cfg.dt);
+
+        while (nextEvent < script.size() && script[nextEvent].time <= now)
+        {
+            if (logic.apply(script[nextEvent].cmd)) stats.accepted++;
+            else stats.rejected++;
+            nextEvent++;
+        }
+
+        stats.steps++;
+    }
+    stats.stopsVisited = (long long)(logic.stopsVisited() - visitsBefore);
+    return stats;
+}
+
+// Branches N runs off one saved state, each with its own random stream,
+// and reports the spread of the outcome.
+static int RunForks(const RunConfig& cfg, const BusLogic& base, double startTime,
+    const std::vector<ScriptEvent>& script, const PassengerDemand* demand)
+{
+    std::vector<uint8_t> bytes;
+    base.saveSnapshot(startTime, bytes);
+    std::vector<BusLogic> forks = ForkSnapshot(bytes.data(), bytes.size(), cfg.forks, cfg.seed + 1, demand);
+
+    auto wallStart = std::chrono::steady_clock::now();
+
+    int minFines = 0, maxFines = 0;
+    double sumFines = 0.0;
+    for (size_t i = 0; i < forks.size(); i++)
+    {
+        RunBus(forks[i], startTime, cfg, script);
+
+        int fines = forks[i].state().totalFines;
+        minFines = (i == 0) ? fines : std::min(minFines, fines);
+        maxFines = (i == 0) ? fines : std::max(maxFines, fines);
+        sumFines += fines;
+    }
+
+    auto wallEnd = std::chrono::steady_clock::now();
+    double wall = std::chrono::duration<double>(wallEnd - wallStart).count();
+
+    std::cout << "forks             : " << forks.size() << " from t = " << startTime << std::endl;
+    std::cout << "wall seconds      : " << wall << std::endl;
+    std::cout << "fines             : mean " << (forks.empty() ? 0.0 : sumFines / forks.size())
+        << ", min " << minFines << ", max " << maxFines << std::endl;
+    return 0;
+}
+
+// Plays a recording made by the 3D app (--record) through BusLogic alone;
+// the final state matches what the app showed at the end of the session.
+static int RunReplay(const RunConfig& cfg, const PassengerDemand* demand)
+{
+    InputReplay replay;
+    if (!replay.load(cfg.replayPath.c_str()))
+    {
+        std::cerr << "cannot load replay " << cfg.replayPath << std::endl;
+        return 2;
+    }
+
+    BusLogic logic;
+    logic.setRandomStream(replay.seed(), 0);
+    logic.setDemand(demand);
+    logic.setSmoothPath(replay.smoothPath());
+
+    auto wallStart = std::chrono::steady_clock::now();
+
+    double lastTime = replay.startTime();
+    for (size_t i = 0; i < replay.frameCount(); i++)
+        ReplayFrame(logic, lastTime, replay.frame(i));
+
+    auto wallEnd = std::chrono::steady_clock::now();
+    double wall = std::chrono::duration<double>(wallEnd - wallStart).count();
+
+    const BusState& st = logic.state();
+
+    std::cout << "replayed frames   : " << replay.frameCount() << std::endl;
+    std::cout << "simulated seconds : " << (lastTime - replay.startTime()) << std::endl;
+    std::cout << "wall seconds      : " << wall << std::endl;
+    std::cout << "frames / wall s   : " << (wall > 0.0 ? (double)replay.frameCount() / wall : 0.0) << std::endl;
+    std::cout << "final state       : point " << st.currentRoutePoint
+        << ", passengers " << st.passengers
+        << ", fines " << st.totalFines << std::endl;
+    return 0;
+}
+
+// Records every step into a rewind buffer, then jumps back `rewindSeconds`
+// and checks the restored state against a snapshot taken live at that step.
+static int RunRewind(const RunConfig& cfg, const std::vector<ScriptEvent>& script, const PassengerDemand* demand)
+{
+    BusLogic logic;
+    logic.setRandomStream(cfg.seed, 0);
+    logic.setDemand(demand);
+    logic.setSmoothPath(cfg.smoothPath);
+    logic.reset(0.0);
+
+    RewindBuffer rewind;
+    rewind.init(REWIND_CAPACITY, REWIND_KEYFRAME_INTERVAL);
+
+    const long long steps = (long long)(cfg.seconds / cfg.dt);
+    const long long back = std::min(steps - 1, (long long)(cfg.rewindSeconds / cfg.dt));
+    const long long checkStep = steps - 1 - back;
+
+    std::vector<uint8_t> expected;
+    size_t nextEvent = 0;
+
+    auto wallStart = std::chrono::steady_clock::now();
+
+    for (long long step = 0; step < steps; step++)
+    {
+        double now = StepTime(0.0, step + 1, cfg.dt);
+        logic.update(now, cfg.dt);
+
+        while (nextEvent < script.size() && script[nextEvent].time <= now)
+            logic.apply(script[nextEvent++].cmd);
+
+        rewind.record(logic, now);
+        if (step == checkStep) logic.saveSnapshot(now, expected);
+    }
+
+    auto wallRecorded = std::chrono::steady_clock::now();
+    uint64_t held = rewind.empty() ? 0 : rewind.newestFrame() - rewind.oldestFrame() + 1;
+    size_t used = rewind.bytesUsed();
+
+    uint64_t frame = rewind.newestFrame() - (uint64_t)back;
+    bool inRange = frame >= rewind.oldestFrame();
+    double restoredTime = 0.0;
+    bool ok = inRange && rewind.seek(frame, logic, &restoredTime);
+
+    auto wallEnd = std::chrono::steady_clock::now();
+
+    std::vector<uint8_t> restored;
+    if (ok) logic.saveSnapshot(restoredTime, restored);
+
+    double recordWall = std::chrono::duration<double>(wallRecorded - wallStart).count();
+    double seekWall = std::chrono::duration<double>(wallEnd - wallRecorded).count();
+
+    std::cout << "frames recorded   : " << steps << " (" << recordWall << " s wall)" << std::endl;
+    std::cout << "ring usage        : " << used << " of " << rewind.capacity() << " bytes" << std::endl;
+    std::cout << "history held      : " << (double)held * cfg.dt << " s before rewinding" << std::endl;
+    if (!inRange)
+    {
+        std::cout << "rewind            : " << cfg.rewindSeconds << " s is older than the buffer" << std::endl;
+        return 0;
+    }
+    std::cout << "rewind            : " << cfg.rewindSeconds << " s in " << seekWall * 1000.0 << " ms, state "
+        << ((ok && restored == expected) ? "matches" : "DIFFERS") << std::endl;
+    return 0;
+}
+
+// Monte Carlo fine revenue per shift, once with the scalar kernel and once
+// with the vector one; both must give the same numbers.
+static int RunFineEstimate(const RunConfig& cfg)
+{
+    FinePolicy policy;
+    policy.inspectionPercent = cfg.inspectionPercent;
+
+    std::cout << "policy            : " << policy.inspectionPercent << "% inspection, "
+        << policy.stopsPerShift << " stops per shift" << std::endl;
+
+    for (int simd = 0; simd < 2; simd++)
+    {
+        FineEstimate e = EstimateFines(policy, cfg.fineShifts, cfg.seed, cfg.threads, simd != 0);
+
+        std::cout << (simd ? "vector kernel     : " : "scalar kernel     : ")
+            << e.shiftsPerSecond << " shifts/s, " << e.stopDrawsPerSecond << " stop draws/s" << std::endl;
+        std::cout << "  mean / variance : " << e.mean << " / " << e.variance << std::endl;
+        std::cout << "  p5 p50 p95 p99  : " << e.p05 << " " << e.p50 << " " << e.p95 << " " << e.p99 << std::endl;
+    }
+    return 0;
+}
+
+// Runs every animation kernel the CPU supports over the same set of door
+// paths and reports actor updates per second; positions must match scalar.
+static int RunAnimBench(const RunConfig& cfg)
+{
+    const int n = cfg.animActors;
+    const int passes = 200;
+    const int rounds = std::max(1, (int)(50000000LL / ((long long)n * passes)));
+
+    ActorPaths initial;
+    initial.reserve(n);
+    for (int i = 0; i < n; i++)
+    {
+        uint32_t r = SimRandom(cfg.seed, 0, (uint64_t)i, RandomLane::Board);
+
+        Actor a;
+        a.startPos = glm::vec3((float)(r & 255) * 0.01f, 0.0f, (float)((r >> 8) & 255) * 0.01f);
+        a.midPos = a.startPos + glm::vec3(0.0f, 0.5f, 0.4f);
+        a.endPos = a.startPos + glm::vec3(0.7f, 0.5f, 1.2f);
+        a.useMid = (r >> 16) & 1;
+        a.duration = 1.6f + (float)((r >> 17) & 7) * 0.1f;
+        a.t = -(float)((r >> 20) & 15) * 0.1f;
+        initial.push(a);
+    }
+
+    std::cout << "animated actors   : " << n << ", " << passes * rounds << " passes" << std::endl;
+
+    double reference = 0.0;
+    const AnimKernel kernels[] = { AnimKernel::Scalar, AnimKernel::SSE, AnimKernel::AVX2 };
+    for (AnimKernel k : kernels)
+    {
+        if (!AnimKernelSupported(k))
+        {
+            std::cout << AnimKernelName(k) << std::string(18 - strlen(AnimKernelName(k)), ' ') << ": not supported" << std::endl;
+            continue;
+        }
+
+        ActorPaths paths;
+        double wall = 0.0;
+        for (int round = 0; round < rounds; round++)
+        {
+            paths = initial;
+
+            auto wallStart = std::chrono::steady_clock::now();
+            for (int pass = 0; pass < passes; pass++)
+                AdvanceActorPaths(paths, 0, n, (float)cfg.dt, k);
+            wall += std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+        }
+
+        double sum = 0.0;
+        for (int i = 0; i < n; i++) sum += paths.posX[i] + paths.posY[i] + paths.posZ[i];
+        if (k == AnimKernel::Scalar) reference = sum;
+
+        double updates = (double)n * passes * rounds;
+        std::cout << AnimKernelName(k) << std::string(18 - strlen(AnimKernelName(k)), ' ') << ": "
+            << (wall > 0.0 ? updates / wall : 0.0) << " actors/s"
+            << (sum == reference ? "" : " (MISMATCH)") << std::endl;
+    }
+
+    return 0;
+}
+
+// Boards `scriptRiders` scripted riders onto enough stopped buses to hold
+// them, twice over: the second wave has to run on the frames the first one
+// left in the pool.
+static int RunScriptBench(const RunConfig& cfg)
+{
+    const int n = cfg.scriptRiders;
+    const BusGeometry& geometry = StandardBusGeometry();
+    const int perBus = geometry.seats.count();
+    const int buses = (n + perBus - 1) / perBus;
+
+    ActorScheduler scheduler;
+    std::deque<ScriptedStop> stops;
+    for (int b = 0; b < buses; b++) stops.emplace_back(scheduler, geometry);
+
+    const ScriptFramePool& pool = ScriptFrames();
+
+    for (int wave = 0; wave < 2; wave++)
+    {
+        scheduler.clear();   // riders --seconds cut short
+        for (int b = 0; b < buses; b++)
+        {
+            stops[b].reset();
+            stops[b].riders.resize(std::min(perBus, n - b * perBus));
+        }
+
+        uint64_t resumesBefore = scheduler.resumeCount();
+        for (int i = 0; i < n; i++)
+        {
+            uint64_t key = SimRandom(cfg.seed, (uint32_t)wave, (uint64_t)i, RandomLane::Board);
+            scheduler.spawn(BoardingSequence(stops[i / perBus], i % perBus, key));
+        }
+
+        if (wave == 0)
+        {
+            std::cout << "scripted riders   : " << n << " on " << buses << " bus(es)" << std::endl;
+            std::cout << "suspended frames  : " << pool.liveFrames() << ", "
+                << (double)pool.reservedBytes() / std::max(1, n) << " pool bytes each" << std::endl;
+        }
+
+        auto wallStart = std::chrono::steady_clock::now();
+        double t = scheduler.now();
+        const double end = t + cfg.seconds;
+        while (scheduler.liveCount() > 0 && t < end)
+        {
+            t += cfg.dt;
+            scheduler.advance(t);
+        }
+        double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+        int seated = 0, standing = 0, refused = 0;
+        for (const ScriptedStop& s : stops)
+        {
+            seated += s.seated;
+            standing += s.standing;
+            refused += s.refused;
+        }
+
+        double resumes = (double)(scheduler.resumeCount() - resumesBefore);
+        std::cout << "wave " << wave << "            : " << seated << " seated, " << standing << " standing, "
+            << refused << " refused, " << scheduler.liveCount() << " unfinished" << std::endl;
+        std::cout << "resumes / wall s  : " << (wall > 0.0 ? resumes / wall : 0.0) << std::endl;
+        std::cout << "pool chunks       : " << pool.chunkCount() << " (" << pool.reservedBytes() << " bytes)" << std::endl;
+    }
+
+    return 0;
+}
+
+// Random-walk polylines standing in for a large real network: open routes
+// with a stop every few points.
+static std::vector<RouteSource> SyntheticRoutes(const RunConfig& cfg)
+{
+    std::vector<RouteSource> routes;
+    routes.push_back(BuiltInRouteSource());
+
+    for (int r = 0; r < cfg.synthRoutes; r++)
+    {
+        RouteSource src;
+        src.name = "synthetic-" + std::to_string(r);
+        src.closed = false;
+        src.points.reserve(cfg.synthPoints);
+
+        float heading = 0.0f;
+        glm::vec2 at(0.0f);
+        for (int i = 0; i < cfg.synthPoints; i++)
+        {
+            uint32_t h = SimRandom(cfg.seed, (uint32_t)r, (uint64_t)i, RandomLane::Board);
+            heading += ((float)(h & 0xFFFF) / 65535.0f - 0.5f) * 0.6f;
+            at += glm::vec2(std::cos(heading), std::sin(heading)) * (5.0f + (float)(h >> 28));
+            src.points.push_back(at);
+            if (i % 8 == 0) src.stops.push_back(i);
+        }
+        routes.push_back(std::move(src));
+    }
+    return routes;
+}
+
+static int RunNetwork(const RunConfig& cfg)
+{
+    std::string path = cfg.networkIn;
+
+    if (!cfg.networkOut.empty())
+    {
+        std::vector<RouteSource> routes;
+        if (!cfg.gtfsDir.empty())
+        {
+            GtfsImportStats gs;
+            std::string error;
+            if (!ImportGtfs(cfg.gtfsDir.c_str(), cfg.threads, routes, gs, error))
+            {
+                std::cerr << "cannot import " << cfg.gtfsDir << ": " << error << std::endl;
+                return 2;
+            }
+
+            long long rows = gs.stopRows + gs.tripRows + gs.shapeRows + gs.stopTimeRows;
+            std::cout << "gtfs rows         : " << gs.stopRows << " stops, " << gs.tripRows << " trips, "
+                << gs.shapeRows << " shape points, " << gs.stopTimeRows << " stop times" << std::endl;
+            std::cout << "gtfs import       : " << gs.seconds << " s on " << cfg.threads << " threads ("
+                << (gs.seconds > 0.0 ? (double)rows / gs.seconds : 0.0) << " rows / s)" << std::endl;
+            std::cout << "gtfs routes       : " << gs.routes << " (" << gs.routesWithoutShape << " without a shape, "
+                << gs.stopTimesUsed << " stop times used)" << std::endl;
+            if (gs.stopsPastShape > 0)
+                std::cout << "gtfs warning      : " << gs.stopsPastShape << " stop(s) past the end of their shape, route extended" << std::endl;
+        }
+        else
+        {
+            routes = SyntheticRoutes(cfg);
+        }
+
+        auto buildStart = std::chrono::steady_clock::now();
+        if (!WriteRouteNetworkFile(cfg.networkOut.c_str(), routes))
+        {
+            std::cerr << "cannot write network " << cfg.networkOut << std::endl;
+            return 2;
+        }
+        double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+        std::cout << "network written   : " << cfg.networkOut << " in " << wall << " s" << std::endl;
+        if (path.empty()) path = cfg.networkOut;
+    }
+
+    auto openStart = std::chrono::steady_clock::now();
+    RouteNetwork net;
+    if (!net.open(path.c_str()))
+    {
+        std::cerr << "cannot open network " << path << std::endl;
+        return 2;
+    }
+    double openWall = std::chrono::duration<double>(std::chrono::steady_clock::now() - openStart).count();
+
+    std::cout << "network           : " << path << " (" << net.sizeBytes() << " bytes, opened in " << openWall * 1000.0 << " ms)" << std::endl;
+    std::cout << "routes            : " << net.routeCount() << std::endl;
+    std::cout << "points            : " << net.pointCount() << std::endl;
+    std::cout << "stops             : " << net.stopCount() << std::endl;
+    if (net.routeCount() == 0) return 0;
+
+    // Random position lookups straight from the mapping.
+    const int LOOKUPS = 1000000;
+    auto lookupStart = std::chrono::steady_clock::now();
+    glm::vec2 sum(0.0f);
+    for (int i = 0; i < LOOKUPS; i++)
+    {
+        uint32_t h = SimRandom(cfg.seed, 0, (uint64_t)i, RandomLane::Alight);
+        RouteView v = net.route(SimRandomBelow(h, net.routeCount()));
+        sum += v.positionAtDistance(v.length * (double)(SimHash32(h) & 0xFFFF) / 65535.0);
+    }
+    double lookupWall = std::chrono::duration<double>(std::chrono::steady_clock::now() - lookupStart).count();
+    std::cout << "lookups / s       : " << (lookupWall > 0.0 ? LOOKUPS / lookupWall : 0.0)
+        << " (checksum " << sum.x + sum.y << ")" << std::endl;
+
+    // The built-in route written out must drive exactly like the compiled one.
+    RouteView builtIn = net.route(0);
+    if (builtIn.nameString() == "built-in")
+    {
+        const float scale = 5.0f;
+        float maxDiff = 0.0f;
+        for (int i = 0; i <= 1000; i++)
+        {
+            double d = builtIn.length * i / 1000.0;
+            glm::vec2 a = builtIn.positionAtDistance(d) * scale;
+            glm::vec3 b = PositionAtDistance(d * scale);
+            maxDiff = std::max(maxDiff, glm::length(glm::vec2(b.x, b.z) - a));
+        }
+        std::cout << "built-in match    : max difference " << maxDiff << std::endl;
+    }
+
+    if (cfg.spatialQueries > 0) RunNetworkQueries(cfg, net);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    RunConfig cfg;
+    if (!ParseArgs(argc, argv, cfg))
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    PassengerDemand demand;
+    if (cfg.demandRate > 0.0f) demand.buildDefault(cfg.demandRate);
+    const PassengerDemand* demandModel = (cfg.demandRate > 0.0f) ? &demand : nullptr;
+
+    if (cfg.fleetSize > 0)
+        return RunFleet(cfg, demandModel);
+    if (cfg.animActors > 0)
+        return RunAnimBench(cfg);
+    if (cfg.scriptRiders > 0)
+        return RunScriptBench(cfg);
+    if (cfg.fineShifts > 0)
+        return RunFineEstimate(cfg);
+    if (!cfg.replayPath.empty())
+        return RunReplay(cfg, demandModel);
+    if (!cfg.networkIn.empty() || !cfg.networkOut.empty())
+        return RunNetwork(cfg);
+
+    std::vector<ScriptEvent> script;
+    if (!cfg.scriptPath.empty())
+    {
+        if (!LoadScript(cfg.scriptPath, script))
+        {
+            std::cerr << "cannot load script " << cfg.scriptPath << std::endl;
+            return 2;
+        }
+    }
+
+    if (cfg.eventBuses > 0)
+        return RunEvents(cfg, script);
+
+    BusLogic logic;
+    logic.setRandomStream(cfg.seed, 0);
+    logic.setDemand(demandModel);
+    logic.setSmoothPath(cfg.smoothPath);
+    logic.reset(0.0);
+
+    double startTime = 0.0;
+    if (!cfg.snapshotIn.empty() && !LoadSnapshotFile(cfg.snapshotIn.c_str(), logic, &startTime))
+    {
+        std::cerr << "cannot load snapshot " << cfg.snapshotIn << std::endl;
+        return 2;
+    }
+    if (cfg.scriptPath.empty() && !demandModel)
+        script = DefaultScript(startTime + cfg.seconds);
+
+    if (cfg.forks > 0)
+        return RunForks(cfg, logic, startTime, script, demandModel);
+    if (cfg.rewindSeconds > 0.0)
+        return RunRewind(cfg, script, demandModel);
+
+    auto wallStart = std::chrono::steady_clock::now();
+
+    RunStats stats = RunBus(logic, startTime, cfg, script);
+
+    auto wallEnd = std::chrono::steady_clock::now();
+    double wall = std::chrono::duration<double>(wallEnd - wallStart).count();
+    double simulated = (double)stats.steps * cfg.dt;
+
+    const BusState& st = logic.state();
+
+    std::cout << "simulated seconds : " << simulated << std::endl;
+    std::cout << "wall seconds      : " << wall << std::endl;
+    std::cout << "sim s / wall s    : " << (wall > 0.0 ? simulated / wall : 0.0) << std::endl;
+    std::cout << "steps / wall s    : " << (wall > 0.0 ? (double)stats.steps / wall : 0.0) << std::endl;
+    std::cout << "commands          : " << stats.accepted << " accepted, " << stats.rejected << " rejected" << std::endl;
+    std::cout << "stops visited     : " << stats.stopsVisited << std::endl;
+    if (cfg.smoothPath)
+        std::cout << "lap length        : " << RouteSpline().totalLength() << " on the spline, "
+            << RouteArc().totalLength() << " on the polyline" << std::endl;
+    std::cout << "final state       : point " << st.currentRoutePoint
+        << ", passengers " << st.passengers
+        << ", fines " << st.totalFines << std::endl;
+
+    if (demandModel) PrintDemand(logic.demandTotals(), wall);
+
+    if (!cfg.snapshotOut.empty())
+    {
+        std::vector<uint8_t> bytes;
+        logic.saveSnapshot(StepTime(startTime, stats.steps, cfg.dt), bytes);
+        if (!WriteSnapshotFile(cfg.snapshotOut.c_str(), bytes))
+        {
+            std::cerr << "cannot write snapshot " << cfg.snapshotOut << std::endl;
+            return 2;
+        }
+        std::cout << "snapshot          : " << cfg.snapshotOut << " (" << bytes.size() << " bytes)" << std::endl;
+    }
+
+    return 0;
+}
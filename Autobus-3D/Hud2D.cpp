@@ -1,13 +1,9 @@
 ﻿#include "Hud2D.h"
+#include "RouteData.h"
 #include <cmath>
 #include <vector>
 #include <algorithm>
 
-extern const int ROUTE_POINT_COUNT;
-extern const float route2D[];
-extern const int STOP_COUNT;
-extern const int stopIndices[];
-
 #define NUM_SLICES 32
 
 static void buildCircle(float* outVerts)
@@ -29,30 +25,36 @@ static glm::vec2 projectToNDC(const glm::vec3& world, const glm::mat4& V, const
     return glm::vec2(ndc.x, ndc.y);
 }
 
-static glm::vec3 uvToPanelLocal(float u, float v)
+static glm::vec3 uvToPanelLocal(const PanelFace& face, float u, float v)
 {
-    const float V_LIFT = 0.08f;
-
     u = glm::clamp(u, 0.0f, 1.0f);
-    v = glm::clamp(v + V_LIFT, 0.0f, 1.0f);
+    v = glm::clamp(v + face.lift, 0.0f, 1.0f);
 
     const float zFace = +0.5f;
-    const float eps = 0.02f;
 
     float x = -0.5f + u;
     float y = -0.5f + v;
 
-    return glm::vec3(x, y, zFace + eps);
+    return glm::vec3(x, y, zFace + face.offset);
+}
+
+// Route coordinates (-1..1) to the map area of the panel face.
+static glm::vec2 mapToPanelUV(const PanelFace& face, float x, float y)
+{
+    float uNorm = (x + 1.0f) * 0.5f;
+    float vNorm = (y + 1.0f) * 0.5f;
+    return glm::vec2(face.mapMin.x + (face.mapMax.x - face.mapMin.x) * uNorm,
+        face.mapMin.y + (face.mapMax.y - face.mapMin.y) * vNorm);
 }
 
 static void drawTexturedQuadOnPanel(Hud2D* hud, GLuint tex, float u0, float v0, float u1, float v1)
 {
     if (!hud->hasPanel || !tex) return;
 
-    glm::vec3 lTL = uvToPanelLocal(u0, v1);
-    glm::vec3 lTR = uvToPanelLocal(u1, v1);
-    glm::vec3 lBR = uvToPanelLocal(u1, v0);
-    glm::vec3 lBL = uvToPanelLocal(u0, v0);
+    glm::vec3 lTL = uvToPanelLocal(hud->face, u0, v1);
+    glm::vec3 lTR = uvToPanelLocal(hud->face, u1, v1);
+    glm::vec3 lBR = uvToPanelLocal(hud->face, u1, v0);
+    glm::vec3 lBL = uvToPanelLocal(hud->face, u0, v0);
 
     auto toWorld = [&](const glm::vec3& lp) {
         return glm::vec3(hud->panelWorld * glm::vec4(lp, 1.0f));
@@ -134,9 +136,10 @@ void Hud2D::setTextures(const unsigned int numTex[10], unsigned int doorOpen, un
     controlTex = control;
 }
 
-void Hud2D::setPanel(const glm::mat4& panelWorld_, const glm::mat4& V_, const glm::mat4& P_)
+void Hud2D::setPanel(const BusGeometry& bus, const glm::mat4& busWorld, const glm::mat4& V_, const glm::mat4& P_)
 {
-    panelWorld = panelWorld_;
+    panelWorld = busWorld * bus.panelLocal;
+    face = bus.panelFace;
     V = V_;
     P = P_;
     hasPanel = true;
@@ -146,23 +149,13 @@ void Hud2D::drawRouteAndStops()
 {
     if (!hasPanel) return;
 
-    const float uMin = 0.42f, uMax = 0.97f;
-    const float vMin = 0.32f, vMax = 0.93f;
-
     std::vector<float> mapped(ROUTE_POINT_COUNT * 2);
 
     for (int i = 0; i < ROUTE_POINT_COUNT; i++)
     {
-        float xN = route2D[i * 2 + 0];
-        float yN = route2D[i * 2 + 1];
+        glm::vec2 uv = mapToPanelUV(face, route2D[i * 2 + 0], route2D[i * 2 + 1]);
 
-        float uNorm = (xN + 1.0f) * 0.5f;
-        float vNorm = (yN + 1.0f) * 0.5f;
-
-        float u = uMin + (uMax - uMin) * uNorm;
-        float v = vMin + (vMax - vMin) * vNorm;
-
-        glm::vec3 lp = uvToPanelLocal(u, v);
+        glm::vec3 lp = uvToPanelLocal(face, uv.x, uv.y);
         glm::vec3 wp = glm::vec3(panelWorld * glm::vec4(lp, 1.0f));
         glm::vec2 ndc = projectToNDC(wp, V, P);
 
@@ -183,16 +176,10 @@ void Hud2D::drawRouteAndStops()
     {
         int ridx = stopIndices[i];
 
-        float xN = route2D[ridx * 2 + 0];
-        float yN = route2D[ridx * 2 + 1];
-
-        float uNorm = (xN + 1.0f) * 0.5f;
-        float vNorm = (yN + 1.0f) * 0.5f;
-
-        float u = uMin + (uMax - uMin) * uNorm;
-        float v = vMin + (vMax - vMin) * vNorm;
+        glm::vec2 uv = mapToPanelUV(face, route2D[ridx * 2 + 0], route2D[ridx * 2 + 1]);
+        float u = uv.x, v = uv.y;
 
-        glm::vec3 lp = uvToPanelLocal(u, v);
+        glm::vec3 lp = uvToPanelLocal(face, u, v);
         glm::vec3 wp = glm::vec3(panelWorld * glm::vec4(lp, 1.0f));
         glm::vec2 ndc = projectToNDC(wp, V, P);
 
@@ -242,16 +229,9 @@ void Hud2D::drawBusMarker(float x, float y)
 {
     if (!hasPanel) return;
 
-    const float uMin = 0.42f, uMax = 0.97f;
-    const float vMin = 0.32f, vMax = 0.93f;
-
-    float uNorm = (x + 1.0f) * 0.5f;
-    float vNorm = (y + 1.0f) * 0.5f;
-
-    float u = uMin + (uMax - uMin) * uNorm;
-    float v = vMin + (vMax - vMin) * vNorm;
+    glm::vec2 uv = mapToPanelUV(face, x, y);
 
-    glm::vec3 lp = uvToPanelLocal(u, v);
+    glm::vec3 lp = uvToPanelLocal(face, uv.x, uv.y);
     glm::vec3 wp = glm::vec3(panelWorld * glm::vec4(lp, 1.0f));
     glm::vec2 ndc = projectToNDC(wp, V, P);
 
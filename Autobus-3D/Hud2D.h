@@ -2,6 +2,7 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include "BusGeometry.h"
 
 struct Hud2D
 {
@@ -19,6 +20,7 @@ struct Hud2D
     unsigned int vaoQuad = 0, vboQuad = 0;
 
     glm::mat4 panelWorld = glm::mat4(1.0f);
+    PanelFace face;
     glm::mat4 V = glm::mat4(1.0f);
     glm::mat4 P = glm::mat4(1.0f);
     bool hasPanel = false;
@@ -26,7 +28,8 @@ struct Hud2D
     void init(unsigned int uiShader_, unsigned int routeShader_, unsigned int circleShader_);
     void setTextures(const unsigned int numTex[10], unsigned int doorOpen, unsigned int doorClosed, unsigned int control);
 
-    void setPanel(const glm::mat4& panelWorld_, const glm::mat4& V_, const glm::mat4& P_);
+    // `busWorld` places the bus-local frame of `bus` in the world.
+    void setPanel(const BusGeometry& bus, const glm::mat4& busWorld, const glm::mat4& V_, const glm::mat4& P_);
 
     void drawRouteAndStops();
     void drawDoorIcon(bool atStop);
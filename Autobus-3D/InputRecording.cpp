@@ -0,0 +1,138 @@
+#include "InputRecording.h"
+#include <cstring>
+
+static const char RECORDING_MAGIC[8] = { 'B', 'U', 'S', 'R', 'E', 'C', 0, 0 };
+
+static constexpr size_t RECORDING_HEADER_SIZE = 8 + 4 + 4 + 8 + 8 + 8 + 4 + 4;
+static constexpr size_t RECORDED_FRAME_SIZE = 9;
+static constexpr size_t RECORDER_FLUSH_BYTES = 64 * 1024;
+
+// Offset of the frame count inside the header, patched on close().
+static constexpr size_t RECORDING_FRAMES_OFFSET = 8 + 4 + 4 + 8 + 8;
+static constexpr size_t RECORDING_FLAGS_OFFSET = RECORDING_FRAMES_OFFSET + 8;
+
+// Header flags: how the session was driven, which a replay has to match.
+static constexpr uint32_t RECORDING_SMOOTH_PATH = 1u << 0;
+
+template <typename T>
+static void PutRaw(std::vector<uint8_t>& buf, const T& v)
+{
+    size_t at = buf.size();
+    buf.resize(at + sizeof(T));
+    memcpy(buf.data() + at, &v, sizeof(T));
+}
+
+template <typename T>
+static T GetRaw(const uint8_t* p)
+{
+    T v;
+    memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+bool InputRecorder::open(const char* path, uint64_t seed, double startTime, bool smoothPath)
+{
+    close();
+
+    out.open(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+
+    frames = 0;
+    buffer.clear();
+    buffer.reserve(RECORDER_FLUSH_BYTES + RECORDED_FRAME_SIZE);
+
+    for (char c : RECORDING_MAGIC) buffer.push_back((uint8_t)c);
+    PutRaw(buffer, RECORDING_VERSION);
+    PutRaw(buffer, (uint32_t)RECORDED_FRAME_SIZE);
+    PutRaw(buffer, seed);
+    PutRaw(buffer, startTime);
+    PutRaw(buffer, frames);
+    PutRaw(buffer, smoothPath ? RECORDING_SMOOTH_PATH : 0u);
+    PutRaw(buffer, (uint32_t)0);
+    flush();
+    return (bool)out;
+}
+
+void InputRecorder::frame(double now, uint8_t commands)
+{
+    if (!out.is_open()) return;
+
+    PutRaw(buffer, now);
+    buffer.push_back(commands);
+    frames++;
+
+    if (buffer.size() >= RECORDER_FLUSH_BYTES) flush();
+}
+
+void InputRecorder::flush()
+{
+    if (buffer.empty()) return;
+    out.write((const char*)buffer.data(), (std::streamsize)buffer.size());
+    buffer.clear();
+}
+
+bool InputRecorder::close()
+{
+    if (!out.is_open()) return false;
+
+    flush();
+    out.seekp((std::streamoff)RECORDING_FRAMES_OFFSET);
+    out.write((const char*)&frames, sizeof(frames));
+
+    bool ok = (bool)out;
+    out.close();
+    return ok;
+}
+
+bool InputReplay::load(const char* path)
+{
+    frameData = nullptr;
+    recFrames = 0;
+
+    if (!file.open(path)) return false;
+
+    const uint8_t* p = file.data();
+    if (file.size() < RECORDING_HEADER_SIZE) return false;
+    if (memcmp(p, RECORDING_MAGIC, sizeof(RECORDING_MAGIC)) != 0) return false;
+    if (GetRaw<uint32_t>(p + 8) != RECORDING_VERSION) return false;
+    if (GetRaw<uint32_t>(p + 12) != RECORDED_FRAME_SIZE) return false;
+
+    recSeed = GetRaw<uint64_t>(p + 16);
+    recStart = GetRaw<double>(p + 24);
+    recFrames = GetRaw<uint64_t>(p + RECORDING_FRAMES_OFFSET);
+    recSmooth = (GetRaw<uint32_t>(p + RECORDING_FLAGS_OFFSET) & RECORDING_SMOOTH_PATH) != 0;
+
+    // A recording cut short (crash, killed process) still replays up to
+    // the last complete frame.
+    uint64_t stored = (file.size() - RECORDING_HEADER_SIZE) / RECORDED_FRAME_SIZE;
+    if (recFrames == 0 || recFrames > stored) recFrames = stored;
+
+    frameData = p + RECORDING_HEADER_SIZE;
+    return true;
+}
+
+RecordedFrame InputReplay::frame(size_t i) const
+{
+    const uint8_t* p = frameData + i * RECORDED_FRAME_SIZE;
+
+    RecordedFrame f;
+    f.now = GetRaw<double>(p);
+    f.commands = p[8];
+    return f;
+}
+
+void ApplyFrameCommands(BusLogic& logic, uint8_t commands)
+{
+    if (commands & CommandBit(SimCommand::PassengerEnter)) logic.tryPassengerEnter();
+    if (commands & CommandBit(SimCommand::PassengerExit)) logic.tryPassengerExit();
+    if (commands & CommandBit(SimCommand::ControlEnter)) logic.tryControlEnter();
+}
+
+void ReplayFrame(BusLogic& logic, double& lastTime, const RecordedFrame& f)
+{
+    double dt = f.now - lastTime;
+    lastTime = f.now;
+
+    logic.update(f.now, dt);
+    ApplyFrameCommands(logic, f.commands);
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include "BusLogic.h"
+#include "MappedFile.h"
+
+constexpr uint32_t RECORDING_VERSION = 2;
+
+inline uint8_t CommandBit(SimCommand cmd) { return (uint8_t)(1u << (int)cmd); }
+
+// One fixed sim step: the clock value handed to BusLogic::update and the
+// commands applied right after it (one bit per SimCommand).
+struct RecordedFrame
+{
+    double now = 0.0;
+    uint8_t commands = 0;
+};
+
+// File layout: a fixed header (magic, version, seed, clock at start, step
+// count, path mode) followed by 9 bytes per sim step: `now` as a raw double
+// and the command mask. dt is never stored; it is rebuilt from consecutive
+// clock values exactly like the sim thread computes it.
+class InputRecorder
+{
+public:
+    ~InputRecorder() { close(); }
+
+    bool open(const char* path, uint64_t seed, double startTime, bool smoothPath);
+    void frame(double now, uint8_t commands);
+    bool close();
+
+    bool isOpen() const { return out.is_open(); }
+
+private:
+    std::ofstream out;
+    std::vector<uint8_t> buffer;
+    uint64_t frames = 0;
+
+    void flush();
+};
+
+class InputReplay
+{
+public:
+    bool load(const char* path);
+
+    uint64_t seed() const { return recSeed; }
+    double startTime() const { return recStart; }
+    bool smoothPath() const { return recSmooth; }
+    size_t frameCount() const { return (size_t)recFrames; }
+    RecordedFrame frame(size_t i) const;
+
+private:
+    MappedFile file;
+    const uint8_t* frameData = nullptr;
+
+    uint64_t recSeed = 0;
+    double recStart = 0.0;
+    uint64_t recFrames = 0;
+    bool recSmooth = false;
+};
+
+// Issues the commands of one step in the same order the sim thread does.
+void ApplyFrameCommands(BusLogic& logic, uint8_t commands);
+
+// Feeds one recorded step through update + commands; `lastTime` carries
+// the previous clock value between calls (start with startTime()).
+void ReplayFrame(BusLogic& logic, double& lastTime, const RecordedFrame& f);
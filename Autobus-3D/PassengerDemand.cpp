@@ -0,0 +1,183 @@
+#include "PassengerDemand.h"
+#include "RouteData.h"
+#include <cmath>
+#include <algorithm>
+
+static constexpr double SECONDS_PER_HOUR = 3600.0;
+static constexpr double SECONDS_PER_DAY = DEMAND_HOURS * SECONDS_PER_HOUR;
+
+// Above this mean the Poisson draw switches from inversion to a normal
+// approximation, which keeps the cost per stop visit constant.
+static constexpr double POISSON_INVERSION_LIMIT = 30.0;
+
+// Share of the peak rate for every hour, midnight first.
+static const float DEFAULT_DAY_PROFILE[DEMAND_HOURS] =
+{
+    0.05f, 0.03f, 0.02f, 0.02f, 0.05f, 0.20f, 0.60f, 1.00f, 0.90f, 0.50f, 0.40f, 0.45f,
+    0.50f, 0.45f, 0.45f, 0.60f, 0.90f, 1.00f, 0.70f, 0.50f, 0.35f, 0.25f, 0.15f, 0.08f,
+};
+
+static double UniformOpen01(uint64_t r)
+{
+    return ((double)(r >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+void AliasTable::build(const float* weights, int n)
+{
+    threshold.assign(n, 0xFFFFFFFFu);
+    alias.resize(n);
+    for (int i = 0; i < n; i++) alias[i] = i;
+    if (n == 0) return;
+
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) sum += std::max(0.0f, weights[i]);
+
+    std::vector<double> scaled(n);
+    for (int i = 0; i < n; i++)
+        scaled[i] = (sum > 0.0) ? std::max(0.0f, weights[i]) * n / sum : 1.0;
+
+    std::vector<int32_t> small, large;
+    for (int i = 0; i < n; i++)
+        (scaled[i] < 1.0 ? small : large).push_back(i);
+
+    while (!small.empty() && !large.empty())
+    {
+        int32_t s = small.back(); small.pop_back();
+        int32_t l = large.back();
+
+        threshold[s] = (uint32_t)std::min(scaled[s] * 4294967296.0, 4294967295.0);
+        alias[s] = l;
+
+        scaled[l] -= 1.0 - scaled[s];
+        if (scaled[l] < 1.0)
+        {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    // Whatever is left holds (up to rounding) probability one.
+}
+
+void PassengerDemand::buildDefault(float peakRidersPerHour)
+{
+    const int stops = STOP_COUNT;
+    const float pi = 3.14159265f;
+
+    rates.assign(stops * DEMAND_HOURS, 0.0f);
+    cumulative.assign(stops * (DEMAND_HOURS + 1), 0.0);
+    destinations.assign(stops, AliasTable());
+
+    std::vector<float> stopWeight(stops);
+    for (int s = 0; s < stops; s++)
+        stopWeight[s] = 0.6f + 0.4f * std::sin(pi * ((float)s + 0.5f) / (float)stops);
+
+    for (int s = 0; s < stops; s++)
+    {
+        float hourly[DEMAND_HOURS];
+        for (int h = 0; h < DEMAND_HOURS; h++)
+            hourly[h] = peakRidersPerHour * stopWeight[s] * DEFAULT_DAY_PROFILE[h];
+        setHourlyRates(s, hourly);
+    }
+
+    // The bus only drives one way round the loop, so far-away stops
+    // (in stops ahead) are less likely destinations.
+    std::vector<float> od(stops);
+    for (int o = 0; o < stops; o++)
+    {
+        for (int d = 0; d < stops; d++)
+        {
+            int hops = (d - o + stops) % stops;
+            od[d] = (hops == 0) ? 0.0f : stopWeight[d] / (float)hops;
+        }
+        setDestinationWeights(o, od.data());
+    }
+}
+
+void PassengerDemand::setHourlyRates(int stop, const float (&ridersPerHour)[DEMAND_HOURS])
+{
+    if (stop < 0 || stop >= stopCount()) return;
+
+    for (int h = 0; h < DEMAND_HOURS; h++)
+        rates[stop * DEMAND_HOURS + h] = std::max(0.0f, ridersPerHour[h]);
+    rebuildCumulative(stop);
+}
+
+void PassengerDemand::setDestinationWeights(int origin, const float* weights)
+{
+    if (origin < 0 || origin >= stopCount()) return;
+    destinations[origin].build(weights, stopCount());
+}
+
+void PassengerDemand::rebuildCumulative(int stop)
+{
+    double* cum = &cumulative[stop * (DEMAND_HOURS + 1)];
+    cum[0] = 0.0;
+    for (int h = 0; h < DEMAND_HOURS; h++)
+        cum[h + 1] = cum[h] + rates[stop * DEMAND_HOURS + h];
+}
+
+double PassengerDemand::arrivalsSinceStart(int stop, double t) const
+{
+    double tod = t + dayStart;
+    double days = std::floor(tod / SECONDS_PER_DAY);
+    double rem = tod - days * SECONDS_PER_DAY;
+
+    int h = std::min(DEMAND_HOURS - 1, (int)(rem / SECONDS_PER_HOUR));
+    const double* cum = &cumulative[stop * (DEMAND_HOURS + 1)];
+
+    return days * cum[DEMAND_HOURS] + cum[h]
+        + (rem - h * SECONDS_PER_HOUR) / SECONDS_PER_HOUR * rates[stop * DEMAND_HOURS + h];
+}
+
+double PassengerDemand::expectedArrivals(int stop, double t0, double t1) const
+{
+    if (stop < 0 || stop >= stopCount() || t1 <= t0) return 0.0;
+    return std::max(0.0, arrivalsSinceStart(stop, t1) - arrivalsSinceStart(stop, t0));
+}
+
+int PassengerDemand::sampleArrivals(int stop, double t0, double t1, uint64_t key) const
+{
+    double lambda = expectedArrivals(stop, t0, t1);
+    if (lambda <= 0.0) return 0;
+
+    if (lambda < POISSON_INVERSION_LIMIT)
+    {
+        double u = UniformOpen01(SimMix64(key));
+        double p = std::exp(-lambda);
+        double f = p;
+        int k = 0;
+        while (u > f && k < 4 * (int)POISSON_INVERSION_LIMIT)
+        {
+            k++;
+            p *= lambda / k;
+            f += p;
+        }
+        return k;
+    }
+
+    double u1 = UniformOpen01(SimMix64(key));
+    double u2 = UniformOpen01(SimMix64(key + 0x9e3779b97f4a7c15ull));
+    double z = std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+    return std::max(0, (int)std::floor(lambda + std::sqrt(lambda) * z + 0.5));
+}
+
+StopDemandResult PassengerDemand::visitStop(int stop, double lastVisit, double now, int room,
+    uint64_t key, int32_t* ridersTo, int32_t& waiting) const
+{
+    StopDemandResult r;
+    if (stop < 0 || stop >= stopCount()) return r;
+
+    r.alighted = ridersTo[stop];
+    ridersTo[stop] = 0;
+
+    waiting += sampleArrivals(stop, lastVisit, now, key);
+    r.boarded = std::min((int)waiting, std::max(0, room + r.alighted));
+    waiting -= r.boarded;
+    r.denied = waiting;
+
+    const AliasTable& table = destinations[stop];
+    for (int k = 0; k < r.boarded; k++)
+        ridersTo[table.sample(SimMix64(key ^ ((uint64_t)(k + 1) * 0xd1b54a32d192ed03ull)))]++;
+
+    return r;
+}
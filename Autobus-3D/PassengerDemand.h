@@ -0,0 +1,78 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "SimRandom.h"
+
+constexpr int DEMAND_HOURS = 24;
+
+// Vose alias table: O(1) draws from a fixed discrete distribution using a
+// single 64-bit random word (high half picks the column, low half the coin).
+struct AliasTable
+{
+    std::vector<uint32_t> threshold;
+    std::vector<int32_t> alias;
+
+    void build(const float* weights, int n);
+    int size() const { return (int)alias.size(); }
+
+    int sample(uint64_t r) const
+    {
+        int i = SimRandomBelow((uint32_t)(r >> 32), size());
+        return ((uint32_t)r < threshold[i]) ? i : alias[i];
+    }
+};
+
+struct StopDemandResult
+{
+    int alighted = 0;
+    int boarded = 0;
+    int denied = 0;   // riders still waiting at the stop when the bus left
+};
+
+struct DemandTotals
+{
+    long long alighted = 0;
+    long long boarded = 0;
+    long long denied = 0;
+
+    void add(const StopDemandResult& r) { alighted += r.alighted; boarded += r.boarded; denied += r.denied; }
+};
+
+// Passenger demand for the route: riders arrive at every stop as a Poisson
+// process whose rate changes with the hour of day, and each rider picks a
+// destination stop from a per-origin O/D alias table. The model itself is
+// read-only, so one instance can be shared by any number of buses/threads.
+class PassengerDemand
+{
+public:
+    // Rates peak at `peakRidersPerHour` in the morning and evening rush;
+    // stops near the middle of the route see more traffic.
+    void buildDefault(float peakRidersPerHour = 120.0f);
+
+    void setHourlyRates(int stop, const float (&ridersPerHour)[DEMAND_HOURS]);
+    void setDestinationWeights(int origin, const float* weights);
+
+    double expectedArrivals(int stop, double t0, double t1) const;
+    int sampleArrivals(int stop, double t0, double t1, uint64_t key) const;
+    int sampleDestination(int origin, uint64_t r) const { return destinations[origin].sample(r); }
+
+    // Everything that happens at one stop visit: riders bound for `stop`
+    // get off, riders who arrived since `lastVisit` join the `waiting` ones
+    // and board while there is room (`room` is the free space before anyone
+    // gets off); whoever does not fit stays in `waiting` for the next bus.
+    // ridersTo[d] counts riders on the bus heading to stop d.
+    StopDemandResult visitStop(int stop, double lastVisit, double now, int room,
+        uint64_t key, int32_t* ridersTo, int32_t& waiting) const;
+
+    int stopCount() const { return (int)destinations.size(); }
+
+    double dayStart = 6.0 * 3600.0;   // sim time 0 is this many seconds after midnight
+
+private:
+    std::vector<float> rates;         // stop * DEMAND_HOURS, riders per hour
+    std::vector<double> cumulative;   // stop * (DEMAND_HOURS + 1), riders since midnight
+    std::vector<AliasTable> destinations;
+
+    double arrivalsSinceStart(int stop, double t) const;
+    void rebuildCumulative(int stop);
+};
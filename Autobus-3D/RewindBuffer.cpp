@@ -0,0 +1,196 @@
+#include "RewindBuffer.h"
+#include "BusLogic.h"
+#include <algorithm>
+#include <cstring>
+
+static void PutVarint(std::vector<uint8_t>& out, size_t v)
+{
+    while (v >= 0x80)
+    {
+        out.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+static size_t GetVarint(const uint8_t*& p)
+{
+    size_t v = 0;
+    int shift = 0;
+    while (*p & 0x80)
+    {
+        v |= (size_t)(*p++ & 0x7F) << shift;
+        shift += 7;
+    }
+    v |= (size_t)(*p++) << shift;
+    return v;
+}
+
+// Delta = XOR of two equally sized snapshots written as
+// (zero run, literal count, literal bytes) pairs.
+static void EncodeDelta(const std::vector<uint8_t>& prev, const std::vector<uint8_t>& cur, std::vector<uint8_t>& out)
+{
+    out.clear();
+    const size_t n = cur.size();
+
+    size_t i = 0;
+    while (i < n)
+    {
+        size_t zeroStart = i;
+        while (i < n && prev[i] == cur[i]) i++;
+        size_t litStart = i;
+        while (i < n && prev[i] != cur[i]) i++;
+
+        PutVarint(out, litStart - zeroStart);
+        PutVarint(out, i - litStart);
+        for (size_t k = litStart; k < i; k++)
+            out.push_back(prev[k] ^ cur[k]);
+    }
+
+    // Never empty, so every entry takes space in the ring.
+    if (out.empty())
+    {
+        PutVarint(out, n);
+        PutVarint(out, 0);
+    }
+}
+
+static void ApplyDelta(const uint8_t* p, size_t size, std::vector<uint8_t>& state)
+{
+    const uint8_t* end = p + size;
+    size_t pos = 0;
+    while (p < end)
+    {
+        pos += GetVarint(p);
+        size_t lit = GetVarint(p);
+        for (size_t k = 0; k < lit; k++)
+            state[pos++] ^= *p++;
+    }
+}
+
+void RewindBuffer::init(size_t capacityBytes, int keyframeInterval)
+{
+    ring.assign(capacityBytes, 0);
+    interval = std::max(1, keyframeInterval);
+    clear();
+}
+
+void RewindBuffer::clear()
+{
+    entries.clear();
+    writePos = 0;
+    nextFrame = 0;
+    sinceKey = 0;
+    previous.clear();
+}
+
+size_t RewindBuffer::bytesUsed() const
+{
+    size_t used = 0;
+    for (const Entry& e : entries) used += e.size;
+    return used;
+}
+
+void RewindBuffer::record(const BusLogic& logic, double now)
+{
+    if (ring.empty()) return;
+
+    logic.saveSnapshot(now, current);
+    uint64_t frame = nextFrame++;
+
+    bool key = entries.empty() || sinceKey + 1 >= interval || previous.size() != current.size();
+    if (key)
+    {
+        store(frame, now, current, true);
+        sinceKey = 0;
+    }
+    else
+    {
+        EncodeDelta(previous, current, encoded);
+        store(frame, now, encoded, false);
+        sinceKey++;
+    }
+
+    previous.swap(current);
+}
+
+void RewindBuffer::store(uint64_t frame, double time, const std::vector<uint8_t>& bytes, bool key)
+{
+    const size_t n = bytes.size();
+    if (n > ring.size())
+    {
+        clear();
+        nextFrame = frame + 1;
+        return;
+    }
+
+    size_t p = writePos;
+    if (p + n > ring.size())
+    {
+        // Wrapping to the start: the tail past writePos holds the oldest
+        // entries and is given up together with them.
+        while (!entries.empty() && entries.front().offset >= writePos)
+            entries.pop_front();
+        p = 0;
+    }
+
+    while (!entries.empty() && entries.front().offset < p + n && p < entries.front().offset + entries.front().size)
+        entries.pop_front();
+
+    memcpy(ring.data() + p, bytes.data(), n);
+
+    Entry e;
+    e.frame = frame;
+    e.time = time;
+    e.offset = p;
+    e.size = n;
+    e.key = key;
+    entries.push_back(e);
+    writePos = p + n;
+
+    // Deltas whose keyframe was overwritten cannot be decoded any more.
+    dropUntilKeyframe();
+}
+
+void RewindBuffer::dropUntilKeyframe()
+{
+    while (!entries.empty() && !entries.front().key)
+        entries.pop_front();
+}
+
+uint64_t RewindBuffer::frameAtTime(double t) const
+{
+    if (entries.empty()) return 0;
+
+    auto it = std::upper_bound(entries.begin(), entries.end(), t,
+        [](double value, const Entry& e) { return value < e.time; });
+    if (it == entries.begin()) return entries.front().frame;
+    return (it - 1)->frame;
+}
+
+bool RewindBuffer::seek(uint64_t frame, BusLogic& logic, double* now)
+{
+    if (entries.empty() || frame < oldestFrame() || frame > newestFrame()) return false;
+
+    size_t target = (size_t)(frame - oldestFrame());
+    size_t key = target;
+    while (!entries[key].key) key--;
+
+    const Entry& k = entries[key];
+    current.assign(ring.begin() + k.offset, ring.begin() + k.offset + k.size);
+    for (size_t i = key + 1; i <= target; i++)
+    {
+        const Entry& d = entries[i];
+        ApplyDelta(ring.data() + d.offset, d.size, current);
+    }
+
+    if (!logic.restoreSnapshot(current.data(), current.size(), now)) return false;
+
+    const Entry last = entries[target];
+    entries.resize(target + 1);
+    writePos = last.offset + last.size;
+    nextFrame = frame + 1;
+    sinceKey = (int)(target - key);
+    previous = current;
+    return true;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <cstddef>
+
+class BusLogic;
+
+// Fixed-size history of BusLogic snapshots for scrubbing back in time.
+// Every `keyframeInterval` frames a full snapshot is stored; frames in
+// between store the XOR against the previous frame, run-length coded, so
+// an unchanged byte costs nothing. All entries live in one byte ring and
+// the oldest ones are dropped when it fills up. Seeking decodes at most
+// one keyframe plus keyframeInterval - 1 deltas.
+class RewindBuffer
+{
+public:
+    void init(size_t capacityBytes, int keyframeInterval);
+    void clear();
+
+    // Stores the state after one frame; `now` is the sim time of that frame.
+    void record(const BusLogic& logic, double now);
+
+    bool empty() const { return entries.empty(); }
+    uint64_t oldestFrame() const { return entries.empty() ? 0 : entries.front().frame; }
+    uint64_t newestFrame() const { return entries.empty() ? 0 : entries.back().frame; }
+    size_t bytesUsed() const;
+    size_t capacity() const { return ring.size(); }
+
+    // Newest stored frame whose time is <= t (the oldest one if none is).
+    uint64_t frameAtTime(double t) const;
+
+    // Restores `frame` into `logic` and drops everything recorded after it,
+    // so recording carries on from there.
+    bool seek(uint64_t frame, BusLogic& logic, double* now = nullptr);
+
+private:
+    struct Entry
+    {
+        uint64_t frame = 0;
+        double time = 0.0;
+        size_t offset = 0;
+        size_t size = 0;
+        bool key = false;
+    };
+
+    std::vector<uint8_t> ring;
+    size_t writePos = 0;
+    std::deque<Entry> entries;
+
+    int interval = 150;
+    uint64_t nextFrame = 0;
+    int sinceKey = 0;
+
+    std::vector<uint8_t> current;
+    std::vector<uint8_t> previous;
+    std::vector<uint8_t> encoded;
+
+    void store(uint64_t frame, double time, const std::vector<uint8_t>& bytes, bool key);
+    void dropUntilKeyframe();
+};
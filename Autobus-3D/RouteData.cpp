@@ -1,24 +1,11 @@
 #include "RouteData.h"
+#include <cmath>
+#include <algorithm>
 
-const int ROUTE_POINT_COUNT = 12;
-
-const float route2D[ROUTE_POINT_COUNT * 2] = {
-    -0.6f, -0.7f,
-     0.3f, -0.5f,
-     0.4f, -0.2f,
-     0.4f,  0.0f,
-     0.6f,  0.1f,
-     0.6f,  0.4f,
-     0.4f,  0.4f,
-     0.4f,  0.6f,
-    -0.1f,  0.7f,
-    -0.3f,  0.6f,
-    -0.6f,  0.6f,
-    -0.5f,  0.0f,
-};
-
-const int STOP_COUNT = 10;
-const int stopIndices[STOP_COUNT] = { 0,1,2,4,5,7,8,9,10,11 };
+static constexpr int SPLINE_SAMPLES_PER_SEGMENT = 64;
+
+// Wheel degrees per unit of curvature (1 / world units) on the spline.
+static constexpr float SPLINE_STEER_PER_CURVATURE = 14.0f;
 
 glm::vec3 RoutePoint3D(int idx, float scale)
 {
@@ -27,16 +14,214 @@ glm::vec3 RoutePoint3D(int idx, float scale)
     return glm::vec3(x, 0.0f, z);
 }
 
-bool IsStopPoint(int routeIdx)
+void RouteArcTable::build(const float* points2D, const float* segmentLength, const float* headingX, const float* headingY,
+    int pointCount, float scale)
+{
+    points.resize(pointCount);
+    cumulative.resize(pointCount + 1);
+
+    for (int i = 0; i < pointCount; i++)
+        points[i] = glm::vec3(points2D[i * 2 + 0] * scale, 0.0f, points2D[i * 2 + 1] * scale);
+
+    double acc = 0.0;
+    for (int i = 0; i < pointCount; i++)
+    {
+        cumulative[i] = acc;
+        acc += (double)segmentLength[i] * scale;
+    }
+    if (pointCount > 0) cumulative[pointCount] = acc;
+
+    // Zero-length segments have a zero heading, so they add no turn.
+    turnAhead.assign(pointCount, 0.0f);
+    for (int i = 0; i < pointCount && pointCount > 2; i++)
+    {
+        int n = (i + 1) % pointCount;
+        float cross = headingX[i] * headingY[n] - headingY[i] * headingX[n];
+        turnAhead[i] = std::min(std::max(cross, -1.0f), 1.0f);
+    }
+}
+
+double RouteArcTable::distanceAtPosition(int seg, float t) const
+{
+    return cumulative[seg] + (double)segmentLength(seg) * (double)t;
+}
+
+void RouteArcTable::locate(double distance, int& seg, float& t) const
+{
+    const int n = pointCount();
+    double total = totalLength();
+    if (n == 0 || total <= 0.0) { seg = 0; t = 0.0f; return; }
+
+    distance = std::fmod(distance, total);
+    if (distance < 0.0) distance += total;
+
+    auto it = std::upper_bound(cumulative.begin(), cumulative.begin() + n, distance);
+    seg = (int)(it - cumulative.begin()) - 1;
+    if (seg < 0) seg = 0;
+
+    double len = cumulative[seg + 1] - cumulative[seg];
+    t = (len > 1e-9) ? (float)((distance - cumulative[seg]) / len) : 0.0f;
+}
+
+glm::vec3 RouteArcTable::positionAtDistance(double distance) const
+{
+    if (points.empty()) return glm::vec3(0.0f);
+
+    int seg;
+    float t;
+    locate(distance, seg, t);
+
+    const glm::vec3& c = points[seg];
+    const glm::vec3& n = points[(seg + 1) % pointCount()];
+    return c + (n - c) * t;
+}
+
+const RouteArcTable& RouteArc()
+{
+    static const RouteArcTable table = []()
+        {
+            RouteArcTable t;
+            const auto& r = RouteDef::BUS_ROUTE;
+            t.build(r.points2D, r.segmentLength, r.headingX, r.headingY, ROUTE_POINT_COUNT, ROUTE_WORLD_SCALE);
+            return t;
+        }();
+    return table;
+}
+
+// Centripetal parameterisation (Barry and Goldman's pyramid): no cusps or
+// self-intersections even where points are unevenly spaced.
+static glm::vec3 CatmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float u)
+{
+    auto knot = [](const glm::vec3& a, const glm::vec3& b)
+        {
+            return std::max(std::sqrt(glm::length(b - a)), 1e-4f);
+        };
+
+    float t0 = 0.0f;
+    float t1 = t0 + knot(p0, p1);
+    float t2 = t1 + knot(p1, p2);
+    float t3 = t2 + knot(p2, p3);
+    float t = t1 + (t2 - t1) * u;
+
+    glm::vec3 a1 = p0 * ((t1 - t) / (t1 - t0)) + p1 * ((t - t0) / (t1 - t0));
+    glm::vec3 a2 = p1 * ((t2 - t) / (t2 - t1)) + p2 * ((t - t1) / (t2 - t1));
+    glm::vec3 a3 = p2 * ((t3 - t) / (t3 - t2)) + p3 * ((t - t2) / (t3 - t2));
+    glm::vec3 b1 = a1 * ((t2 - t) / (t2 - t0)) + a2 * ((t - t0) / (t2 - t0));
+    glm::vec3 b2 = a2 * ((t3 - t) / (t3 - t1)) + a3 * ((t - t1) / (t3 - t1));
+    return b1 * ((t2 - t) / (t2 - t1)) + b2 * ((t - t1) / (t2 - t1));
+}
+
+void RouteSplineTable::build(const float* points2D, int pointCount, float scale, int samples)
+{
+    samplesPerSegment = std::max(1, samples);
+    const int total = pointCount * samplesPerSegment;
+
+    this->samples.resize(total + 1);
+    cumulative.resize(total + 1);
+    curvature.assign(total + 1, 0.0f);
+    if (pointCount == 0) return;
+
+    auto point = [&](int i)
+        {
+            i = ((i % pointCount) + pointCount) % pointCount;
+            return glm::vec3(points2D[i * 2 + 0] * scale, 0.0f, points2D[i * 2 + 1] * scale);
+        };
+
+    for (int seg = 0; seg < pointCount; seg++)
+    {
+        glm::vec3 p0 = point(seg - 1), p1 = point(seg), p2 = point(seg + 1), p3 = point(seg + 2);
+        for (int j = 0; j < samplesPerSegment; j++)
+            this->samples[seg * samplesPerSegment + j] = CatmullRom(p0, p1, p2, p3, (float)j / samplesPerSegment);
+    }
+    this->samples[total] = this->samples[0];
+
+    double acc = 0.0;
+    cumulative[0] = 0.0;
+    for (int i = 0; i < total; i++)
+    {
+        acc += glm::length(this->samples[i + 1] - this->samples[i]);
+        cumulative[i + 1] = acc;
+    }
+
+    // Signed Menger curvature of each sample and its two neighbours.
+    for (int i = 0; i < total; i++)
+    {
+        const glm::vec3& a = this->samples[(i + total - 1) % total];
+        const glm::vec3& b = this->samples[i];
+        const glm::vec3& c = this->samples[(i + 1) % total];
+
+        glm::vec3 ab = b - a, bc = c - b, ac = c - a;
+        float denom = glm::length(ab) * glm::length(bc) * glm::length(ac);
+        float cross = ab.x * bc.z - ab.z * bc.x;
+        curvature[i] = (denom > 1e-12f) ? 2.0f * cross / denom : 0.0f;
+    }
+    curvature[total] = curvature[0];
+}
+
+float RouteSplineTable::segmentLength(int seg) const
+{
+    return (float)(cumulative[(seg + 1) * samplesPerSegment] - cumulative[seg * samplesPerSegment]);
+}
+
+void RouteSplineTable::locate(int seg, float t, int& sample, float& frac) const
+{
+    const int first = seg * samplesPerSegment;
+    const int last = first + samplesPerSegment;
+
+    double d = cumulative[first] + (cumulative[last] - cumulative[first]) * (double)std::min(std::max(t, 0.0f), 1.0f);
+    auto it = std::upper_bound(cumulative.begin() + first, cumulative.begin() + last, d);
+    sample = std::max(first, (int)(it - cumulative.begin()) - 1);
+
+    double len = cumulative[sample + 1] - cumulative[sample];
+    frac = (len > 1e-12) ? (float)((d - cumulative[sample]) / len) : 0.0f;
+}
+
+glm::vec3 RouteSplineTable::position(int seg, float t) const
+{
+    int i;
+    float f;
+    locate(seg, t, i, f);
+    return samples[i] + (samples[i + 1] - samples[i]) * f;
+}
+
+float RouteSplineTable::curvatureAt(int seg, float t) const
+{
+    int i;
+    float f;
+    locate(seg, t, i, f);
+    return curvature[i] + (curvature[i + 1] - curvature[i]) * f;
+}
+
+const RouteSplineTable& RouteSpline()
+{
+    static const RouteSplineTable table = []()
+        {
+            RouteSplineTable t;
+            t.build(route2D, ROUTE_POINT_COUNT, ROUTE_WORLD_SCALE, SPLINE_SAMPLES_PER_SEGMENT);
+            return t;
+        }();
+    return table;
+}
+
+float RouteSteerTarget(int seg, float t, bool smooth)
+{
+    float target = smooth
+        ? RouteSpline().curvatureAt(seg, t) * SPLINE_STEER_PER_CURVATURE
+        : RouteArc().turnAhead[seg] * STEER_MAX_DEG;
+    return std::min(std::max(target, -STEER_MAX_DEG), STEER_MAX_DEG);
+}
+
+float SegmentLength(int seg)
+{
+    return RouteArc().segmentLength(seg);
+}
+
+double DistanceAtPosition(int seg, float t)
 {
-    for (int i = 0; i < STOP_COUNT; i++)
-        if (stopIndices[i] == routeIdx) return true;
-    return false;
+    return RouteArc().distanceAtPosition(seg, t);
 }
 
-int StopNumberForRouteIdx(int routeIdx)
+glm::vec3 PositionAtDistance(double distance)
 {
-    for (int i = 0; i < STOP_COUNT; i++)
-        if (stopIndices[i] == routeIdx) return i;
-    return -1;
+    return RouteArc().positionAtDistance(distance);
 }
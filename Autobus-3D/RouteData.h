@@ -1,13 +1,90 @@
 #pragma once
 #include <vector>
 #include <glm/glm.hpp>
+#include "../Shared/RouteDef.h"
 
-extern const int STOP_COUNT;
-extern const int ROUTE_POINT_COUNT;
+constexpr int ROUTE_POINT_COUNT = RouteDef::BUS_ROUTE.pointCount;
+constexpr int STOP_COUNT = RouteDef::BUS_ROUTE.stopCount;
 
-extern const float route2D[];
-extern const int stopIndices[];
+constexpr const float* route2D = RouteDef::BUS_ROUTE.points2D;
+constexpr const int* stopIndices = RouteDef::BUS_ROUTE.stopIndices;
 
-glm::vec3 RoutePoint3D(int idx, float scale = 5.0f);
-bool IsStopPoint(int routeIdx);
-int StopNumberForRouteIdx(int routeIdx);
+// Panel units to world units for the 3D view.
+constexpr float ROUTE_WORLD_SCALE = 5.0f;
+
+// Steering wheel angle (degrees) at full lock.
+constexpr float STEER_MAX_DEG = 28.0f;
+
+glm::vec3 RoutePoint3D(int idx, float scale = ROUTE_WORLD_SCALE);
+
+inline bool IsStopPoint(int routeIdx)
+{
+    return routeIdx >= 0 && routeIdx < ROUTE_POINT_COUNT && RouteDef::BUS_ROUTE.isStop(routeIdx);
+}
+
+inline int StopNumberForRouteIdx(int routeIdx)
+{
+    if (routeIdx < 0 || routeIdx >= ROUTE_POINT_COUNT) return -1;
+    return RouteDef::BUS_ROUTE.stopNumber[routeIdx];
+}
+
+// Cumulative arc length of a closed route: cumulative[i] is the distance
+// driven from point 0 to point i, cumulative[count] closes the loop.
+struct RouteArcTable
+{
+    std::vector<glm::vec3> points;
+    std::vector<double> cumulative;
+    std::vector<float> turnAhead;   // sine of the turn at the end of each segment, + to the left
+
+    // From a compiled route's points and per-segment length and heading
+    // tables (see RouteDef::CompiledRoute), all in panel units.
+    void build(const float* points2D, const float* segmentLength, const float* headingX, const float* headingY,
+        int pointCount, float scale);
+
+    int pointCount() const { return (int)points.size(); }
+    double totalLength() const { return cumulative.empty() ? 0.0 : cumulative.back(); }
+    float segmentLength(int seg) const { return (float)(cumulative[seg + 1] - cumulative[seg]); }
+
+    double distanceAtPosition(int seg, float t) const;
+    void locate(double distance, int& seg, float& t) const;
+    glm::vec3 positionAtDistance(double distance) const;
+};
+
+// Arc table of the built-in route at the default RoutePoint3D scale.
+const RouteArcTable& RouteArc();
+
+// Closed centripetal Catmull-Rom spline through the route points, sampled
+// once into arc-length and curvature tables. Positions are looked up by
+// (segment, fraction of that segment's arc length), the same pair the
+// polyline uses, so either can drive the bus.
+struct RouteSplineTable
+{
+    int samplesPerSegment = 0;
+    std::vector<glm::vec3> samples;   // segment s starts at s * samplesPerSegment, last sample closes the loop
+    std::vector<double> cumulative;   // arc length at each sample
+    std::vector<float> curvature;     // signed, 1 / world units, + to the left
+
+    void build(const float* points2D, int pointCount, float scale, int samplesPerSegment);
+
+    int pointCount() const { return samplesPerSegment > 0 ? (int)(samples.size() - 1) / samplesPerSegment : 0; }
+    double totalLength() const { return cumulative.empty() ? 0.0 : cumulative.back(); }
+    float segmentLength(int seg) const;
+
+    glm::vec3 position(int seg, float t) const;
+    float curvatureAt(int seg, float t) const;
+
+private:
+    void locate(int seg, float t, int& sample, float& frac) const;
+};
+
+// Spline of the built-in route at the default RoutePoint3D scale.
+const RouteSplineTable& RouteSpline();
+
+// Steering wheel target in degrees at a point of the route: looked up from
+// the spline's curvature or, on the polyline, from the turn at the end of
+// the current segment.
+float RouteSteerTarget(int seg, float t, bool smooth);
+
+float SegmentLength(int seg);
+double DistanceAtPosition(int seg, float t);
+glm::vec3 PositionAtDistance(double distance);
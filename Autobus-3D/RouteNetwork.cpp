@@ -0,0 +1,267 @@
+#include "RouteNetwork.h"
+#include "RouteData.h"
+#include <cmath>
+#include <cstring>
+#include <climits>
+#include <fstream>
+
+static const char ROUTE_NETWORK_MAGIC[8] = { 'B', 'U', 'S', 'N', 'E', 'T', 0, 0 };
+
+static uint64_t Align8(uint64_t x) { return (x + 7) & ~(uint64_t)7; }
+
+static bool SectionFits(uint64_t offset, uint64_t bytes, uint64_t size)
+{
+    return offset % 8 == 0 && offset <= size && bytes <= size - offset;
+}
+
+// `count` elements of `elemSize` bytes, checked without forming the product.
+static bool ArrayFits(uint64_t offset, uint64_t count, uint64_t elemSize, uint64_t size)
+{
+    return offset % 8 == 0 && offset <= size && count <= (size - offset) / elemSize;
+}
+
+static bool RangeFits(uint64_t first, uint64_t count, uint64_t total)
+{
+    return first <= total && count <= total - first;
+}
+
+void RouteView::locate(double distance, int& seg, float& t) const
+{
+    const int n = segmentCount();
+    if (n == 0 || length <= 0.0) { seg = 0; t = 0.0f; return; }
+
+    if (closed)
+    {
+        distance = std::fmod(distance, length);
+        if (distance < 0.0) distance += length;
+    }
+    else
+    {
+        distance = std::min(std::max(distance, 0.0), length);
+    }
+
+    const double* it = std::upper_bound(cumulative, cumulative + n, distance);
+    seg = std::max(0, (int)(it - cumulative) - 1);
+
+    double len = cumulative[seg + 1] - cumulative[seg];
+    t = (len > 1e-9) ? (float)std::min((distance - cumulative[seg]) / len, 1.0) : 0.0f;
+}
+
+glm::vec2 RouteView::positionAtDistance(double distance) const
+{
+    if (pointCount == 0) return glm::vec2(0.0f);
+    if (pointCount == 1) return point(0);
+
+    int seg;
+    float t;
+    locate(distance, seg, t);
+
+    glm::vec2 c = point(seg);
+    glm::vec2 n = point((seg + 1) % pointCount);
+    return c + (n - c) * t;
+}
+
+bool RouteNetwork::open(const char* path)
+{
+    close();
+    if (!file.open(path)) return false;
+    if (attach(file.data(), file.size())) return true;
+
+    file.close();
+    return false;
+}
+
+void RouteNetwork::close()
+{
+    header = nullptr;
+    base = nullptr;
+    file.close();
+}
+
+bool RouteNetwork::attach(const void* data, size_t size)
+{
+    header = nullptr;
+    base = nullptr;
+    if (!data || size < sizeof(RouteNetworkHeader)) return false;
+
+    const RouteNetworkHeader* h = (const RouteNetworkHeader*)data;
+    if (memcmp(h->magic, ROUTE_NETWORK_MAGIC, sizeof(ROUTE_NETWORK_MAGIC)) != 0) return false;
+    if (h->version != ROUTE_NETWORK_VERSION || h->byteOrder != ROUTE_NETWORK_BYTE_ORDER) return false;
+    if (h->totalSize > size) return false;
+
+    // Counts reach the caller as int (routeCount(), RouteView); a route's
+    // own counts are bounded by these.
+    if (h->routeCount > INT_MAX || h->pointCount > INT_MAX || h->stopCount > INT_MAX) return false;
+
+    const uint64_t n = h->totalSize;
+    const uint64_t cumulativeCount = h->pointCount + h->routeCount;
+    if (!ArrayFits(h->routesOffset, h->routeCount, sizeof(RouteRecord), n)) return false;
+    if (!ArrayFits(h->pointsOffset, h->pointCount, 2 * sizeof(float), n)) return false;
+    if (!ArrayFits(h->segmentsOffset, h->pointCount, sizeof(float), n)) return false;
+    if (!ArrayFits(h->cumulativeOffset, cumulativeCount, sizeof(double), n)) return false;
+    if (!ArrayFits(h->stopNumberOffset, h->pointCount, sizeof(int32_t), n)) return false;
+    if (!ArrayFits(h->stopsOffset, h->stopCount, sizeof(uint32_t), n)) return false;
+    if (!SectionFits(h->namesOffset, h->nameBytes, n)) return false;
+
+    // Only the route table is checked; point data is used as stored.
+    const uint8_t* p = (const uint8_t*)data;
+    const RouteRecord* records = (const RouteRecord*)(p + h->routesOffset);
+    for (uint64_t r = 0; r < h->routeCount; r++)
+    {
+        const RouteRecord& rec = records[r];
+        if (!RangeFits(rec.firstPoint, rec.pointCount, h->pointCount)) return false;
+        if (!RangeFits(rec.firstCumulative, (uint64_t)rec.pointCount + 1, cumulativeCount)) return false;
+        if (!RangeFits(rec.firstStop, rec.stopCount, h->stopCount)) return false;
+        if (!RangeFits(rec.nameOffset, rec.nameLength, h->nameBytes)) return false;
+        if (rec.nameLength > INT_MAX) return false;
+    }
+
+    base = p;
+    header = h;
+    return true;
+}
+
+RouteView RouteNetwork::route(int r) const
+{
+    RouteView v;
+    if (!header || r < 0 || (uint64_t)r >= header->routeCount) return v;
+
+    const RouteRecord& rec = ((const RouteRecord*)(base + header->routesOffset))[r];
+
+    v.points2D = (const float*)(base + header->pointsOffset) + rec.firstPoint * 2;
+    v.segmentLength = (const float*)(base + header->segmentsOffset) + rec.firstPoint;
+    v.cumulative = (const double*)(base + header->cumulativeOffset) + rec.firstCumulative;
+    v.stopNumber = (const int32_t*)(base + header->stopNumberOffset) + rec.firstPoint;
+    v.stops = (const uint32_t*)(base + header->stopsOffset) + rec.firstStop;
+    v.name = (const char*)(base + header->namesOffset) + rec.nameOffset;
+    v.nameLength = (int)rec.nameLength;
+
+    v.pointCount = (int)rec.pointCount;
+    v.stopCount = (int)rec.stopCount;
+    v.closed = rec.closed != 0;
+    v.length = rec.length;
+    return v;
+}
+
+static bool SourceValid(const RouteSource& src)
+{
+    if (src.points.size() > UINT32_MAX || src.name.size() > UINT32_MAX) return false;
+    for (size_t i = 0; i < src.stops.size(); i++)
+    {
+        if (src.stops[i] < 0 || (size_t)src.stops[i] >= src.points.size()) return false;
+        if (i > 0 && src.stops[i] <= src.stops[i - 1]) return false;
+    }
+    return true;
+}
+
+bool BuildRouteNetwork(const std::vector<RouteSource>& routes, std::vector<uint8_t>& out)
+{
+    RouteNetworkHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, ROUTE_NETWORK_MAGIC, sizeof(ROUTE_NETWORK_MAGIC));
+    h.version = ROUTE_NETWORK_VERSION;
+    h.byteOrder = ROUTE_NETWORK_BYTE_ORDER;
+    h.routeCount = routes.size();
+
+    for (const RouteSource& src : routes)
+    {
+        if (!SourceValid(src)) return false;
+        h.pointCount += src.points.size();
+        h.stopCount += src.stops.size();
+        h.nameBytes += src.name.size();
+    }
+
+    h.routesOffset = sizeof(RouteNetworkHeader);
+    h.pointsOffset = h.routesOffset + h.routeCount * sizeof(RouteRecord);
+    h.segmentsOffset = Align8(h.pointsOffset + h.pointCount * 2 * sizeof(float));
+    h.cumulativeOffset = Align8(h.segmentsOffset + h.pointCount * sizeof(float));
+    h.stopNumberOffset = h.cumulativeOffset + (h.pointCount + h.routeCount) * sizeof(double);
+    h.stopsOffset = Align8(h.stopNumberOffset + h.pointCount * sizeof(int32_t));
+    h.namesOffset = Align8(h.stopsOffset + h.stopCount * sizeof(uint32_t));
+    h.totalSize = Align8(h.namesOffset + h.nameBytes);
+
+    out.assign((size_t)h.totalSize, 0);
+    uint8_t* p = out.data();
+    memcpy(p, &h, sizeof(h));
+
+    RouteRecord* records = (RouteRecord*)(p + h.routesOffset);
+    float* points = (float*)(p + h.pointsOffset);
+    float* segments = (float*)(p + h.segmentsOffset);
+    double* cumulative = (double*)(p + h.cumulativeOffset);
+    int32_t* stopNumber = (int32_t*)(p + h.stopNumberOffset);
+    uint32_t* stops = (uint32_t*)(p + h.stopsOffset);
+    char* names = (char*)(p + h.namesOffset);
+
+    uint64_t point = 0, cum = 0, stop = 0, name = 0;
+    for (size_t r = 0; r < routes.size(); r++)
+    {
+        const RouteSource& src = routes[r];
+        const size_t n = src.points.size();
+
+        RouteRecord& rec = records[r];
+        rec.firstPoint = point;
+        rec.firstCumulative = cum;
+        rec.firstStop = stop;
+        rec.nameOffset = name;
+        rec.pointCount = (uint32_t)n;
+        rec.stopCount = (uint32_t)src.stops.size();
+        rec.nameLength = (uint32_t)src.name.size();
+        rec.closed = src.closed ? 1 : 0;
+
+        double acc = 0.0;
+        for (size_t i = 0; i < n; i++)
+        {
+            const glm::vec2& a = src.points[i];
+            points[(point + i) * 2 + 0] = a.x;
+            points[(point + i) * 2 + 1] = a.y;
+            stopNumber[point + i] = -1;
+
+            float len = 0.0f;
+            if (i + 1 < n || (src.closed && n > 1))
+                len = glm::length(src.points[(i + 1) % n] - a);
+
+            segments[point + i] = len;
+            cumulative[cum + i] = acc;
+            acc += len;
+        }
+        cumulative[cum + n] = acc;
+        rec.length = acc;
+
+        for (size_t s = 0; s < src.stops.size(); s++)
+        {
+            stops[stop + s] = (uint32_t)src.stops[s];
+            stopNumber[point + src.stops[s]] = (int32_t)s;
+        }
+
+        if (!src.name.empty()) memcpy(names + name, src.name.data(), src.name.size());
+
+        point += n;
+        cum += n + 1;
+        stop += src.stops.size();
+        name += src.name.size();
+    }
+    return true;
+}
+
+bool WriteRouteNetworkFile(const char* path, const std::vector<RouteSource>& routes)
+{
+    std::vector<uint8_t> bytes;
+    if (!BuildRouteNetwork(routes, bytes)) return false;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    out.write((const char*)bytes.data(), (std::streamsize)bytes.size());
+    return (bool)out;
+}
+
+RouteSource BuiltInRouteSource()
+{
+    RouteSource src;
+    src.name = "built-in";
+    src.closed = true;
+    for (int i = 0; i < ROUTE_POINT_COUNT; i++)
+        src.points.push_back(glm::vec2(route2D[i * 2 + 0], route2D[i * 2 + 1]));
+    for (int i = 0; i < STOP_COUNT; i++)
+        src.stops.push_back(stopIndices[i]);
+    return src;
+}
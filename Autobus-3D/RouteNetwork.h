@@ -0,0 +1,124 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include "MappedFile.h"
+
+constexpr uint32_t ROUTE_NETWORK_VERSION = 1;
+constexpr uint32_t ROUTE_NETWORK_BYTE_ORDER = 0x01020304u;
+
+// Route network file: header, one RouteRecord per route, then flat arrays
+// shared by all routes (points as x,y pairs, segment lengths, cumulative
+// distances, stop number per point, stop point indices, route names). A
+// route is a range in each array. Every section starts on an 8-byte
+// boundary, so a mapped file is used as is with nothing parsed or copied.
+struct RouteNetworkHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint64_t totalSize;
+
+    uint64_t routeCount;
+    uint64_t pointCount;
+    uint64_t stopCount;
+    uint64_t nameBytes;
+
+    uint64_t routesOffset;
+    uint64_t pointsOffset;
+    uint64_t segmentsOffset;
+    uint64_t cumulativeOffset;
+    uint64_t stopNumberOffset;
+    uint64_t stopsOffset;
+    uint64_t namesOffset;
+};
+
+struct RouteRecord
+{
+    uint64_t firstPoint;
+    uint64_t firstCumulative;   // pointCount + 1 entries
+    uint64_t firstStop;
+    uint64_t nameOffset;
+
+    uint32_t pointCount;
+    uint32_t stopCount;
+    uint32_t nameLength;
+    uint32_t closed;
+
+    double length;
+};
+
+static_assert(sizeof(RouteNetworkHeader) % 8 == 0, "route network header must keep 8-byte alignment");
+static_assert(sizeof(RouteRecord) % 8 == 0, "route record must keep 8-byte alignment");
+
+// One route read straight from the network data. Segment i runs from point
+// i to point i + 1; a closed route has a last segment back to point 0.
+// Distances are in the units the points were written in.
+struct RouteView
+{
+    const float* points2D = nullptr;
+    const float* segmentLength = nullptr;
+    const double* cumulative = nullptr;
+    const int32_t* stopNumber = nullptr;   // -1 for points that are not stops
+    const uint32_t* stops = nullptr;       // point index of each stop
+    const char* name = nullptr;
+    int nameLength = 0;
+
+    int pointCount = 0;
+    int stopCount = 0;
+    bool closed = false;
+    double length = 0.0;
+
+    glm::vec2 point(int i) const { return glm::vec2(points2D[i * 2 + 0], points2D[i * 2 + 1]); }
+    bool isStop(int i) const { return stopNumber[i] >= 0; }
+    int segmentCount() const { return closed ? pointCount : std::max(0, pointCount - 1); }
+    std::string nameString() const { return std::string(name, (size_t)nameLength); }
+
+    double distanceAtPosition(int seg, float t) const { return cumulative[seg] + (double)segmentLength[seg] * (double)t; }
+
+    // Closed routes wrap the distance around, open ones clamp it.
+    void locate(double distance, int& seg, float& t) const;
+    glm::vec2 positionAtDistance(double distance) const;
+};
+
+class RouteNetwork
+{
+public:
+    bool open(const char* path);
+    void close();
+
+    // Uses data that stays owned by the caller; it must outlive the views.
+    bool attach(const void* data, size_t size);
+
+    bool isOpen() const { return header != nullptr; }
+    int routeCount() const { return header ? (int)header->routeCount : 0; }
+    uint64_t pointCount() const { return header ? header->pointCount : 0; }
+    uint64_t stopCount() const { return header ? header->stopCount : 0; }
+    size_t sizeBytes() const { return header ? (size_t)header->totalSize : 0; }
+
+    RouteView route(int r) const;
+
+private:
+    MappedFile file;
+    const uint8_t* base = nullptr;
+    const RouteNetworkHeader* header = nullptr;
+};
+
+// Input for the writer: points in any planar units, stops as strictly
+// increasing point indices.
+struct RouteSource
+{
+    std::string name;
+    std::vector<glm::vec2> points;
+    std::vector<int> stops;
+    bool closed = true;
+};
+
+bool BuildRouteNetwork(const std::vector<RouteSource>& routes, std::vector<uint8_t>& out);
+bool WriteRouteNetworkFile(const char* path, const std::vector<RouteSource>& routes);
+
+// The compiled-in route (panel units) as a writer input.
+RouteSource BuiltInRouteSource();
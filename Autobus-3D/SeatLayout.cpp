@@ -0,0 +1,124 @@
+#include "SeatLayout.h"
+#include <algorithm>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static constexpr float SEAT_PITCH = 0.75f;
+static constexpr float STANDING_PITCH = 0.35f;
+static constexpr float WINDOW_SEAT_INSET = 0.35f;
+static constexpr float AISLE_SEAT_INSET = 0.80f;
+static constexpr float STANDING_X = 0.12f;
+
+// Clear space kept behind the door and in front of the back wall.
+static constexpr float DOOR_CLEARANCE = 0.50f;
+static constexpr float BACK_CLEARANCE = 0.35f;
+
+static int LowestBit(uint64_t x)
+{
+#if defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward64(&i, x);
+    return (int)i;
+#else
+    return __builtin_ctzll(x);
+#endif
+}
+
+void SeatLayout::build(const glm::vec3& busCenter, float busLength, float busWidth, float riderY, float doorEndZ)
+{
+    seats.clear();
+
+    float z0 = doorEndZ + DOOR_CLEARANCE;
+    float z1 = busLength * 0.5f - BACK_CLEARANCE;
+    if (z1 < z0) return;
+
+    const float halfWidth = busWidth * 0.5f;
+    const float seatX[4] = {
+        -(halfWidth - WINDOW_SEAT_INSET), -(halfWidth - AISLE_SEAT_INSET),
+        +(halfWidth - AISLE_SEAT_INSET), +(halfWidth - WINDOW_SEAT_INSET)
+    };
+
+    int rows = (int)((z1 - z0) / SEAT_PITCH) + 1;
+    for (int r = 0; r < rows; r++)
+    {
+        for (float x : seatX)
+        {
+            SeatTransform t;
+            t.pos = glm::vec3(busCenter.x + x, riderY, busCenter.z + z0 + r * SEAT_PITCH);
+            t.yawDeg = 180.0f;
+            seats.push_back(t);
+        }
+    }
+    seated = (int)seats.size();
+
+    // Standing riders face each other across the aisle a little.
+    int spots = (int)((z1 - z0) / STANDING_PITCH) + 1;
+    for (int r = 0; r < spots; r++)
+    {
+        for (int side = 0; side < 2; side++)
+        {
+            SeatTransform t;
+            float x = side == 0 ? -STANDING_X : +STANDING_X;
+            t.pos = glm::vec3(busCenter.x + x, riderY, busCenter.z + z0 + r * STANDING_PITCH);
+            t.yawDeg = side == 0 ? 160.0f : 200.0f;
+            t.standing = true;
+            seats.push_back(t);
+        }
+    }
+
+    if ((int)seats.size() > SeatAllocator::MAX_SEATS) seats.resize(SeatAllocator::MAX_SEATS);
+}
+
+void SeatAllocator::reset(int count)
+{
+    seatCount = std::min(std::max(count, 0), MAX_SEATS);
+    taken = 0;
+
+    int words = (seatCount + 63) / 64;
+    freeBits.assign(words, ~(uint64_t)0);
+    if (seatCount % 64) freeBits[words - 1] = ((uint64_t)1 << (seatCount % 64)) - 1;
+
+    summary = (words == 64) ? ~(uint64_t)0 : (((uint64_t)1 << words) - 1);
+}
+
+int SeatAllocator::acquire()
+{
+    if (summary == 0) return -1;
+
+    int w = LowestBit(summary);
+    int b = LowestBit(freeBits[w]);
+
+    freeBits[w] &= freeBits[w] - 1;
+    if (freeBits[w] == 0) summary &= ~((uint64_t)1 << w);
+
+    taken++;
+    return w * 64 + b;
+}
+
+void SeatAllocator::release(int seat)
+{
+    if (seat < 0 || seat >= seatCount || isFree(seat)) return;
+
+    int w = seat >> 6;
+    freeBits[w] |= (uint64_t)1 << (seat & 63);
+    summary |= (uint64_t)1 << w;
+    taken--;
+}
+
+bool SeatAllocator::take(int seat)
+{
+    if (seat < 0 || seat >= seatCount || !isFree(seat)) return false;
+
+    int w = seat >> 6;
+    freeBits[w] &= ~((uint64_t)1 << (seat & 63));
+    if (freeBits[w] == 0) summary &= ~((uint64_t)1 << w);
+    taken++;
+    return true;
+}
+
+bool SeatAllocator::isFree(int seat) const
+{
+    return (freeBits[seat >> 6] >> (seat & 63)) & 1;
+}
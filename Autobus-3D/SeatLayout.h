@@ -0,0 +1,54 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+struct SeatTransform
+{
+    glm::vec3 pos = glm::vec3(0.0f);
+    float yawDeg = 180.0f;
+    bool standing = false;
+};
+
+// Places riders inside the bus: rows of seats on both sides of the aisle
+// behind the door, then standing spots along the aisle. Seats come first
+// and run front to back, so the allocator fills them in that order.
+class SeatLayout
+{
+public:
+    // `doorEndZ` is the back edge of the door relative to `busCenter`.
+    void build(const glm::vec3& busCenter, float busLength, float busWidth, float riderY, float doorEndZ);
+
+    int count() const { return (int)seats.size(); }
+    int seatedCount() const { return seated; }
+    const SeatTransform& seat(int i) const { return seats[i]; }
+
+private:
+    std::vector<SeatTransform> seats;
+    int seated = 0;
+};
+
+// Free-seat bitset with a one-word summary of which words still have a free
+// bit, so acquire() is two bit scans and release() two bit sets for up to
+// 64 * 64 seats. The lowest free index is always handed out first.
+class SeatAllocator
+{
+public:
+    static constexpr int MAX_SEATS = 64 * 64;
+
+    void reset(int seatCount);
+
+    int acquire();              // -1 when every seat is taken
+    void release(int seat);
+    bool take(int seat);        // claims a specific seat, false if it was taken
+
+    int capacity() const { return seatCount; }
+    int used() const { return taken; }
+    bool isFree(int seat) const;
+
+private:
+    std::vector<uint64_t> freeBits;
+    uint64_t summary = 0;
+    int seatCount = 0;
+    int taken = 0;
+};
@@ -0,0 +1,32 @@
+#include "SimInterpolation.h"
+#include "RouteData.h"
+
+void CaptureSimFrame(const BusLogic& logic, float wheelSteer, SimFrame& out)
+{
+    const BusState& st = logic.state();
+
+    out.marker = glm::vec2(st.busPos.x, st.busPos.z) / ROUTE_WORLD_SCALE;
+    out.wheelSteer = wheelSteer;
+    out.moving = logic.movingActors();
+}
+
+void InterpolateSimFrames(const SimFrame& prev, const SimFrame& cur, float alpha, SimFrame& out)
+{
+    out.marker = glm::mix(prev.marker, cur.marker, alpha);
+    out.wheelSteer = glm::mix(prev.wheelSteer, cur.wheelSteer, alpha);
+    out.moving = cur.moving;
+
+    // Moving actors keep their relative order from step to step (finished
+    // ones are compacted out, new ones appended), so one forward scan
+    // pairs them up.
+    size_t j = 0;
+    for (Actor& a : out.moving)
+    {
+        size_t k = j;
+        while (k < prev.moving.size() && prev.moving[k].id != a.id) k++;
+        if (k == prev.moving.size()) continue;
+
+        a.pos = glm::mix(prev.moving[k].pos, a.pos, alpha);
+        j = k + 1;
+    }
+}
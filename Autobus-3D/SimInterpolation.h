@@ -0,0 +1,21 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include "Actor.h"
+#include "BusLogic.h"
+
+// What the renderer needs from one fixed sim step. The sim runs at its own
+// rate; each rendered frame blends the last two of these by how far the
+// clock has moved into the next step.
+struct SimFrame
+{
+    glm::vec2 marker = glm::vec2(0.0f);   // bus on the 2D route map
+    float wheelSteer = 0.0f;
+    std::vector<Actor> moving;
+};
+
+void CaptureSimFrame(const BusLogic& logic, float wheelSteer, SimFrame& out);
+
+// alpha = 0 gives `prev`, 1 gives `cur`. Actors are matched by id; one that
+// only exists in `cur` is drawn where it is.
+void InterpolateSimFrames(const SimFrame& prev, const SimFrame& cur, float alpha, SimFrame& out);
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+
+// Counter-based random numbers: a draw is a pure function of
+// (seed, stream, counter, lane), so it does not depend on call order or on
+// which thread asks. Streams are bus ids, counters are sim ticks and lanes
+// separate independent decisions taken on the same tick.
+
+enum class RandomLane : uint32_t
+{
+    Fine = 1,
+    Alight = 2,
+    Board = 3,
+    Inspection = 4,
+    Demand = 5,
+};
+
+inline uint64_t SimMix64(uint64_t x)
+{
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27; x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+inline uint32_t SimRandom(uint64_t seed, uint32_t stream, uint64_t counter, RandomLane lane)
+{
+    uint64_t key = SimMix64(seed + 0x9e3779b97f4a7c15ull * (((uint64_t)stream << 8) | (uint32_t)lane));
+    return (uint32_t)(SimMix64(key ^ (counter * 0xd1b54a32d192ed03ull)) >> 32);
+}
+
+// 32-bit mixer (lowbias32). It only needs 32-bit multiplies, so SIMD
+// kernels can run it lane by lane and match this scalar version exactly.
+inline uint32_t SimHash32(uint32_t x)
+{
+    x ^= x >> 16; x *= 0x7feb352du;
+    x ^= x >> 15; x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// Maps a 32-bit draw onto [0, n) without division.
+inline int SimRandomBelow(uint32_t r, int n)
+{
+    if (n <= 0) return 0;
+    return (int)(((uint64_t)r * (uint32_t)n) >> 32);
+}
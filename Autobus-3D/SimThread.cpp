@@ -0,0 +1,163 @@
+#include "SimThread.h"
+#include "RouteData.h"
+#include <chrono>
+#include <algorithm>
+
+double SimThread::Clock()
+{
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+void SimThread::start(const SimThreadConfig& config)
+{
+    stop();
+    cfg = config;
+
+    uint64_t seed = cfg.seed;
+    simTime = cfg.startTime;
+
+    isReplaying = cfg.replayPath && replay.load(cfg.replayPath);
+    replayStep = 0;
+    if (isReplaying)
+    {
+        seed = replay.seed();
+        simTime = replay.startTime();
+    }
+    sim.setRandomStream(seed, 0);
+    sim.setSmoothPath(isReplaying ? replay.smoothPath() : cfg.smoothPath);
+    if (cfg.geometry) sim.setGeometry(*cfg.geometry);
+
+    isRecording = cfg.recordPath && !isReplaying && recorder.open(cfg.recordPath, seed, simTime, cfg.smoothPath);
+
+    // A rewind jump is not a recorded command, so it is off while
+    // recording or replaying.
+    rewindEnabled = !isReplaying && !isRecording && cfg.rewindBytes > 0;
+    if (rewindEnabled) rewind.init(cfg.rewindBytes, cfg.rewindKeyframeInterval);
+
+    wheelSteer = 0.0f;
+    CaptureSimFrame(sim, wheelSteer, curFrame);
+    prevFrame = curFrame;
+    publish(Clock());
+
+    steps = 0;
+    busy = 0.0;
+    done.store(false);
+    running.store(true);
+    worker = std::thread(&SimThread::run, this);
+}
+
+void SimThread::stop()
+{
+    running.store(false);
+    if (worker.joinable()) worker.join();
+    recorder.close();
+}
+
+const RenderSnapshot& SimThread::latest()
+{
+    out.fetch();
+    return out.readSlot();
+}
+
+void SimThread::run()
+{
+    double next = Clock();
+
+    while (running.load(std::memory_order_relaxed))
+    {
+        if (isReplaying)
+        {
+            // Replays run flat out; the window shows whatever is newest.
+            if (!step()) break;
+            publish(Clock());
+            continue;
+        }
+
+        double now = Clock();
+        if (now < next)
+        {
+            std::this_thread::sleep_for(std::chrono::duration<double>(next - now));
+            continue;
+        }
+
+        // After a stall, catch up at most maxCatchUpSteps and drop the rest.
+        next = std::max(next, now - cfg.maxCatchUpSteps * cfg.stepDt);
+
+        if (rewindRequested.exchange(false) && rewindEnabled)
+        {
+            double restoredTime = simTime;
+            if (rewind.seek(rewind.frameAtTime(simTime - cfg.rewindStep), sim, &restoredTime))
+            {
+                simTime = restoredTime;
+                CaptureSimFrame(sim, wheelSteer, curFrame);
+                prevFrame = curFrame;
+            }
+        }
+
+        step();
+        publish(next);
+        next += cfg.stepDt;
+    }
+
+    done.store(true, std::memory_order_release);
+}
+
+bool SimThread::step()
+{
+    double t0 = Clock();
+
+    if (isReplaying)
+    {
+        if (replayStep >= replay.frameCount()) return false;
+
+        double before = simTime;
+        ReplayFrame(sim, simTime, replay.frame(replayStep++));
+        steerWheel(simTime - before);
+    }
+    else
+    {
+        // Input that arrived since the last step is applied right after it,
+        // the same order ReplayFrame uses.
+        double now = simTime + cfg.stepDt;
+        double dt = now - simTime;
+        simTime = now;
+
+        uint8_t commands = pendingCommands.exchange(0, std::memory_order_relaxed);
+        sim.update(now, dt);
+        ApplyFrameCommands(sim, commands);
+        recorder.frame(now, commands);
+
+        steerWheel(dt);
+    }
+
+    if (rewindEnabled) rewind.record(sim, simTime);
+
+    std::swap(prevFrame, curFrame);
+    CaptureSimFrame(sim, wheelSteer, curFrame);
+
+    steps++;
+    busy += Clock() - t0;
+    return true;
+}
+
+// Turns the wheel towards the bend ahead.
+void SimThread::steerWheel(double dt)
+{
+    const BusState& st = sim.state();
+
+    float targetSteer = 0.0f;
+    if (!st.atStop) targetSteer = RouteSteerTarget(st.currentRoutePoint, st.travelT, sim.smoothPath());
+    wheelSteer = glm::mix(wheelSteer, targetSteer, (float)(dt * 8.0));
+}
+
+void SimThread::publish(double clock)
+{
+    RenderSnapshot& snap = out.writeSlot();
+    snap.state = sim.state();
+    snap.inside = sim.insideActors();
+    snap.prev = prevFrame;
+    snap.cur = curFrame;
+    snap.stepClock = clock;
+    out.publish();
+}
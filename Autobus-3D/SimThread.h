@@ -0,0 +1,99 @@
+#pragma once
+#include <atomic>
+#include <thread>
+#include <cstdint>
+#include "ActorPool.h"
+#include "BusLogic.h"
+#include "InputRecording.h"
+#include "RewindBuffer.h"
+#include "SimInterpolation.h"
+#include "TripleBuffer.h"
+
+// Everything the renderer reads for one frame. `prev` and `cur` are the
+// last two sim steps; `stepClock` is SimThread::Clock() when `cur` was
+// produced, so the renderer can blend between them.
+struct RenderSnapshot
+{
+    BusState state;
+    ActorPool inside;
+    SimFrame prev;
+    SimFrame cur;
+    double stepClock = 0.0;
+};
+
+struct SimThreadConfig
+{
+    uint64_t seed = 0;
+    double startTime = 0.0;
+    const char* recordPath = nullptr;
+    const char* replayPath = nullptr;
+
+    bool smoothPath = false;
+    const BusGeometry* geometry = nullptr;   // the standard bus when null
+
+    double stepDt = 1.0 / 60.0;
+    int maxCatchUpSteps = 8;
+
+    size_t rewindBytes = 0;
+    int rewindKeyframeInterval = 150;
+    double rewindStep = 5.0;
+};
+
+// Runs BusLogic in fixed steps on its own thread. Input comes in through
+// atomics and state goes out through a triple buffer, so neither the sim
+// nor the render loop ever blocks on the other.
+class SimThread
+{
+public:
+    ~SimThread() { stop(); }
+
+    void start(const SimThreadConfig& config);
+    void stop();
+
+    // Render side.
+    void pushCommands(uint8_t commands) { pendingCommands.fetch_or(commands, std::memory_order_relaxed); }
+    void requestRewind() { rewindRequested.store(true, std::memory_order_relaxed); }
+    const RenderSnapshot& latest();
+
+    bool replaying() const { return isReplaying; }
+    bool recording() const { return isRecording; }
+    bool finished() const { return done.load(std::memory_order_acquire); }
+
+    // Only valid once stop() returned.
+    const BusLogic& logic() const { return sim; }
+    uint64_t stepsRun() const { return steps; }
+    double busySeconds() const { return busy; }
+
+    static double Clock();
+
+private:
+    SimThreadConfig cfg;
+    BusLogic sim;
+    double simTime = 0.0;
+    float wheelSteer = 0.0f;
+
+    InputReplay replay;
+    bool isReplaying = false;
+    size_t replayStep = 0;
+    InputRecorder recorder;
+    bool isRecording = false;
+    RewindBuffer rewind;
+    bool rewindEnabled = false;
+
+    SimFrame prevFrame, curFrame;
+    TripleBuffer<RenderSnapshot> out;
+
+    std::atomic<uint8_t> pendingCommands{ 0 };
+    std::atomic<bool> rewindRequested{ false };
+    std::atomic<bool> running{ false };
+    std::atomic<bool> done{ false };
+    std::thread worker;
+
+    uint64_t steps = 0;
+    double busy = 0.0;
+
+    void run();
+    bool step();
+    void steerWheel(double dt);
+    void publish(double clock);
+};
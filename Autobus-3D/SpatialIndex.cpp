@@ -0,0 +1,306 @@
+#include "SpatialIndex.h"
+#include <algorithm>
+#include <cmath>
+
+void GridLayout::init(glm::vec2 minCorner, glm::vec2 maxCorner, float cell)
+{
+    cellSize = std::max(cell, 1e-6f);
+    invCellSize = 1.0f / cellSize;
+    origin = minCorner;
+
+    // Keeps the grid to a sane size even for a tiny cell over a huge area.
+    const float MAX_CELLS_PER_AXIS = 4096.0f;
+    glm::vec2 extent = glm::max(maxCorner - minCorner, glm::vec2(cellSize));
+    cols = (int)std::min(std::ceil(extent.x * invCellSize), MAX_CELLS_PER_AXIS);
+    rows = (int)std::min(std::ceil(extent.y * invCellSize), MAX_CELLS_PER_AXIS);
+    cols = std::max(cols, 1);
+    rows = std::max(rows, 1);
+}
+
+int GridLayout::column(float x) const
+{
+    int c = (int)std::floor((x - origin.x) * invCellSize);
+    return std::min(std::max(c, 0), cols - 1);
+}
+
+int GridLayout::row(float y) const
+{
+    int r = (int)std::floor((y - origin.y) * invCellSize);
+    return std::min(std::max(r, 0), rows - 1);
+}
+
+// Calls f(cell) for every cell at Chebyshev distance `ring` from (cx, cy).
+template <typename F>
+static void ForEachRingCell(const GridLayout& g, int cx, int cy, int ring, F f)
+{
+    int x0 = cx - ring, x1 = cx + ring;
+    int y0 = cy - ring, y1 = cy + ring;
+
+    for (int y = std::max(y0, 0); y <= std::min(y1, g.rows - 1); y++)
+    {
+        bool edgeRow = (y == y0 || y == y1);
+        for (int x = std::max(x0, 0); x <= std::min(x1, g.cols - 1); x++)
+        {
+            if (!edgeRow && x != x0 && x != x1)
+            {
+                x = x1 - 1;   // jump over the ring's interior
+                continue;
+            }
+            f(y * g.cols + x);
+        }
+    }
+}
+
+// Smallest ring that can still hold something closer than `dist`: a cell
+// `ring` steps away is at least (ring - 1) cells from any point in the
+// centre cell.
+static bool RingCanBeCloser(const GridLayout& g, int ring, float dist)
+{
+    return (float)(ring - 1) * g.cellSize <= dist;
+}
+
+static int MaxRing(const GridLayout& g, int cx, int cy)
+{
+    return std::max(std::max(cx, g.cols - 1 - cx), std::max(cy, g.rows - 1 - cy));
+}
+
+template <typename Item, typename Visit>
+static void FillCells(std::vector<uint32_t>& start, std::vector<Item>& items, int cellCount, Visit visit)
+{
+    // Two passes over the same visitor: count per cell, then place.
+    start.assign(cellCount + 1, 0);
+    visit([&](int cell, const Item&) { start[cell + 1]++; });
+    for (int c = 0; c < cellCount; c++) start[c + 1] += start[c];
+
+    items.resize(start[cellCount]);
+    std::vector<uint32_t> fill(start.begin(), start.end() - 1);
+    visit([&](int cell, const Item& it) { items[fill[cell]++] = it; });
+}
+
+void RouteSpatialIndex::build(const RouteNetwork& network, float cellSize)
+{
+    routes.clear();
+    routes.reserve(network.routeCount());
+
+    glm::vec2 lo(1e30f), hi(-1e30f);
+    double totalLength = 0.0;
+    long long segmentCount = 0;
+
+    for (int r = 0; r < network.routeCount(); r++)
+    {
+        RouteView v = network.route(r);
+        for (int i = 0; i < v.pointCount; i++)
+        {
+            lo = glm::min(lo, v.point(i));
+            hi = glm::max(hi, v.point(i));
+        }
+        totalLength += v.length;
+        segmentCount += v.segmentCount();
+        routes.push_back(v);
+    }
+    if (lo.x > hi.x) lo = hi = glm::vec2(0.0f);
+
+    if (cellSize <= 0.0f)
+        cellSize = (segmentCount > 0) ? (float)(2.0 * totalLength / (double)segmentCount) : 1.0f;
+    grid.init(lo, hi, cellSize);
+
+    FillCells(stopStart, stopItems, grid.cellCount(), [&](auto emit)
+        {
+            for (size_t r = 0; r < routes.size(); r++)
+            {
+                const RouteView& v = routes[r];
+                for (int s = 0; s < v.stopCount; s++)
+                    emit(grid.cellOf(v.point((int)v.stops[s])), Item{ (uint32_t)r, (uint32_t)s });
+            }
+        });
+
+    // A segment goes into every cell its bounding box touches.
+    FillCells(segStart, segItems, grid.cellCount(), [&](auto emit)
+        {
+            for (size_t r = 0; r < routes.size(); r++)
+            {
+                const RouteView& v = routes[r];
+                for (int s = 0; s < v.segmentCount(); s++)
+                {
+                    glm::vec2 a = v.point(s);
+                    glm::vec2 b = v.point((s + 1) % v.pointCount);
+                    int c0 = grid.column(std::min(a.x, b.x)), c1 = grid.column(std::max(a.x, b.x));
+                    int r0 = grid.row(std::min(a.y, b.y)), r1 = grid.row(std::max(a.y, b.y));
+
+                    for (int y = r0; y <= r1; y++)
+                        for (int x = c0; x <= c1; x++)
+                            emit(y * grid.cols + x, Item{ (uint32_t)r, (uint32_t)s });
+                }
+            }
+        });
+}
+
+float RouteSpatialIndex::stopDistance(const Item& it, glm::vec2 p) const
+{
+    const RouteView& v = routes[it.route];
+    return glm::length(v.point((int)v.stops[it.index]) - p);
+}
+
+float RouteSpatialIndex::segmentDistance(const Item& it, glm::vec2 p, float& t) const
+{
+    const RouteView& v = routes[it.route];
+    glm::vec2 a = v.point((int)it.index);
+    glm::vec2 ab = v.point(((int)it.index + 1) % v.pointCount) - a;
+
+    float len2 = glm::dot(ab, ab);
+    t = (len2 > 0.0f) ? std::min(std::max(glm::dot(p - a, ab) / len2, 0.0f), 1.0f) : 0.0f;
+    return glm::length(a + ab * t - p);
+}
+
+bool RouteSpatialIndex::nearestStop(glm::vec2 p, float maxRadius, StopHit& out) const
+{
+    if (stopItems.empty()) return false;
+
+    int cx = grid.column(p.x), cy = grid.row(p.y);
+    float best = maxRadius;
+    bool found = false;
+
+    for (int ring = 0, last = MaxRing(grid, cx, cy); ring <= last && RingCanBeCloser(grid, ring, best); ring++)
+    {
+        ForEachRingCell(grid, cx, cy, ring, [&](int c)
+            {
+                for (uint32_t i = stopStart[c]; i < stopStart[c + 1]; i++)
+                {
+                    float d = stopDistance(stopItems[i], p);
+                    if (d <= best)
+                    {
+                        best = d;
+                        out.route = (int)stopItems[i].route;
+                        out.stop = (int)stopItems[i].index;
+                        out.distance = d;
+                        found = true;
+                    }
+                }
+            });
+    }
+    return found;
+}
+
+bool RouteSpatialIndex::nearestSegment(glm::vec2 p, float maxRadius, SegmentHit& out) const
+{
+    if (segItems.empty()) return false;
+
+    int cx = grid.column(p.x), cy = grid.row(p.y);
+    float best = maxRadius;
+    bool found = false;
+
+    for (int ring = 0, last = MaxRing(grid, cx, cy); ring <= last && RingCanBeCloser(grid, ring, best); ring++)
+    {
+        ForEachRingCell(grid, cx, cy, ring, [&](int c)
+            {
+                for (uint32_t i = segStart[c]; i < segStart[c + 1]; i++)
+                {
+                    float t;
+                    float d = segmentDistance(segItems[i], p, t);
+                    if (d <= best)
+                    {
+                        best = d;
+                        out.route = (int)segItems[i].route;
+                        out.segment = (int)segItems[i].index;
+                        out.t = t;
+                        out.distance = d;
+                        found = true;
+                    }
+                }
+            });
+    }
+    return found;
+}
+
+void RouteSpatialIndex::stopsInRadius(glm::vec2 p, float radius, std::vector<StopHit>& out) const
+{
+    out.clear();
+    int c0 = grid.column(p.x - radius), c1 = grid.column(p.x + radius);
+    int r0 = grid.row(p.y - radius), r1 = grid.row(p.y + radius);
+
+    for (int y = r0; y <= r1; y++)
+    {
+        for (int x = c0; x <= c1; x++)
+        {
+            int c = y * grid.cols + x;
+            for (uint32_t i = stopStart[c]; i < stopStart[c + 1]; i++)
+            {
+                float d = stopDistance(stopItems[i], p);
+                if (d <= radius) out.push_back({ (int)stopItems[i].route, (int)stopItems[i].index, d });
+            }
+        }
+    }
+}
+
+void BusGrid::reset(glm::vec2 minCorner, glm::vec2 maxCorner, float cellSize, int count)
+{
+    grid.init(minCorner, maxCorner, cellSize);
+    head.assign(grid.cellCount(), -1);
+    next.assign(count, -1);
+    prev.assign(count, -1);
+    cell.assign(count, -1);
+    pos.assign(count, glm::vec2(0.0f));
+    moves = 0;
+}
+
+void BusGrid::update(int id, glm::vec2 p)
+{
+    pos[id] = p;
+    int c = grid.cellOf(p);
+    int old = cell[id];
+    if (c == old) return;
+
+    if (old >= 0)
+    {
+        if (prev[id] >= 0) next[prev[id]] = next[id];
+        else head[old] = next[id];
+        if (next[id] >= 0) prev[next[id]] = prev[id];
+    }
+
+    prev[id] = -1;
+    next[id] = head[c];
+    if (head[c] >= 0) prev[head[c]] = id;
+    head[c] = id;
+    cell[id] = c;
+    moves++;
+}
+
+void BusGrid::inRadius(glm::vec2 p, float radius, std::vector<int>& out) const
+{
+    out.clear();
+    const float r2 = radius * radius;
+    int c0 = grid.column(p.x - radius), c1 = grid.column(p.x + radius);
+    int r0 = grid.row(p.y - radius), r1 = grid.row(p.y + radius);
+
+    for (int y = r0; y <= r1; y++)
+    {
+        for (int x = c0; x <= c1; x++)
+        {
+            for (int id = head[y * grid.cols + x]; id >= 0; id = next[id])
+            {
+                glm::vec2 d = pos[id] - p;
+                if (glm::dot(d, d) <= r2) out.push_back(id);
+            }
+        }
+    }
+}
+
+int BusGrid::nearest(glm::vec2 p, float maxRadius) const
+{
+    int cx = grid.column(p.x), cy = grid.row(p.y);
+    float best = maxRadius;
+    int found = -1;
+
+    for (int ring = 0, last = MaxRing(grid, cx, cy); ring <= last && RingCanBeCloser(grid, ring, best); ring++)
+    {
+        ForEachRingCell(grid, cx, cy, ring, [&](int c)
+            {
+                for (int id = head[c]; id >= 0; id = next[id])
+                {
+                    float d = glm::length(pos[id] - p);
+                    if (d <= best) { best = d; found = id; }
+                }
+            });
+    }
+    return found;
+}
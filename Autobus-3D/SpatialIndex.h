@@ -0,0 +1,95 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include "RouteNetwork.h"
+
+// Cell arithmetic shared by both grids. Points outside the bounds are
+// clamped into the border cells, so nothing is ever lost, only slower.
+struct GridLayout
+{
+    glm::vec2 origin = glm::vec2(0.0f);
+    float cellSize = 1.0f;
+    float invCellSize = 1.0f;
+    int cols = 1;
+    int rows = 1;
+
+    void init(glm::vec2 minCorner, glm::vec2 maxCorner, float cell);
+    int cellCount() const { return cols * rows; }
+    int column(float x) const;
+    int row(float y) const;
+    int cellOf(glm::vec2 p) const { return row(p.y) * cols + column(p.x); }
+};
+
+struct StopHit
+{
+    int route = -1;
+    int stop = -1;        // stop number within the route
+    float distance = 0.0f;
+};
+
+struct SegmentHit
+{
+    int route = -1;
+    int segment = -1;
+    float t = 0.0f;       // closest position along the segment
+    float distance = 0.0f;
+};
+
+// Static uniform grid over the stops and segments of a route network. Each
+// cell lists what overlaps it in one flat array (offsets per cell), and
+// positions are read from the network itself. Nearest queries search
+// rings of cells outward and stop as soon as no closer cell can exist.
+class RouteSpatialIndex
+{
+public:
+    // cellSize <= 0 picks one from the average segment length.
+    void build(const RouteNetwork& network, float cellSize = 0.0f);
+
+    bool nearestStop(glm::vec2 p, float maxRadius, StopHit& out) const;
+    bool nearestSegment(glm::vec2 p, float maxRadius, SegmentHit& out) const;
+    void stopsInRadius(glm::vec2 p, float radius, std::vector<StopHit>& out) const;
+
+    const GridLayout& layout() const { return grid; }
+    size_t segmentEntries() const { return segItems.size(); }
+
+private:
+    struct Item { uint32_t route; uint32_t index; };
+
+    GridLayout grid;
+    std::vector<RouteView> routes;
+
+    std::vector<uint32_t> stopStart;
+    std::vector<Item> stopItems;
+    std::vector<uint32_t> segStart;
+    std::vector<Item> segItems;
+
+    float stopDistance(const Item& it, glm::vec2 p) const;
+    float segmentDistance(const Item& it, glm::vec2 p, float& t) const;
+};
+
+// Grid of moving points (buses) kept up to date one move at a time: every
+// cell is a doubly linked list, so a bus that changes cell is relinked in
+// O(1) and one that stays put costs a compare.
+class BusGrid
+{
+public:
+    void reset(glm::vec2 minCorner, glm::vec2 maxCorner, float cellSize, int count);
+    void update(int id, glm::vec2 p);
+
+    void inRadius(glm::vec2 p, float radius, std::vector<int>& out) const;
+    int nearest(glm::vec2 p, float maxRadius) const;
+
+    int size() const { return (int)pos.size(); }
+    glm::vec2 position(int id) const { return pos[id]; }
+    uint64_t relinks() const { return moves; }
+
+private:
+    GridLayout grid;
+    std::vector<int32_t> head;
+    std::vector<int32_t> next;
+    std::vector<int32_t> prev;
+    std::vector<int32_t> cell;
+    std::vector<glm::vec2> pos;
+    uint64_t moves = 0;
+};
@@ -0,0 +1,38 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Single producer / single consumer handoff without locks. The writer fills
+// its own slot and swaps it into the middle; the reader swaps the middle
+// out whenever something new was published. Neither side ever waits, and a
+// slot is never touched by both at once. Readers that fall behind simply
+// skip to the newest value.
+template <typename T>
+class TripleBuffer
+{
+public:
+    // Writer side.
+    T& writeSlot() { return slots[back]; }
+    void publish()
+    {
+        back = middle.exchange((uint8_t)(back | FRESH), std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // Reader side. Returns true when a newer value was taken.
+    bool fetch()
+    {
+        if (!(middle.load(std::memory_order_acquire) & FRESH)) return false;
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+    const T& readSlot() const { return slots[front]; }
+
+private:
+    static constexpr uint8_t INDEX_MASK = 0x3;
+    static constexpr uint8_t FRESH = 0x4;
+
+    T slots[3];
+    uint8_t back = 0;
+    std::atomic<uint8_t> middle{ 1 };
+    uint8_t front = 2;
+};
@@ -9,6 +9,7 @@
 #include <string>
 #include <fstream>
 #include <ctime>
+#include <cstring>
 #include <vector>
 
 #include <GL/glew.h>
@@ -22,6 +23,7 @@
 #include "Hud2D.h"
 #include "RouteData.h"
 #include "BusLogic.h"
+#include "SimThread.h"
 
 #include "shader.hpp"
 #include "model.hpp"
@@ -40,6 +42,18 @@ static bool cullEnabled = true;
 static bool prevLMB = false;
 static bool prevRMB = false;
 static bool prevK = false;
+static bool prevB = false;
+
+// B jumps the simulation back this far; the buffer keeps several minutes.
+static constexpr double REWIND_STEP = 5.0;
+static constexpr size_t REWIND_BYTES = 16 * 1024 * 1024;
+static constexpr int REWIND_KEYFRAME_INTERVAL = 150;
+
+// The sim thread advances in fixed steps of SIM_DT whatever the frame
+// rate; frames in between are interpolated. After a long stall at most
+// MAX_SIM_STEPS are run and the rest of the lag is dropped.
+static constexpr double SIM_DT = 1.0 / 60.0;
+static constexpr int MAX_SIM_STEPS = 8;
 
 static unsigned int numberTex[10]{};
 static unsigned int controlTex = 0;
@@ -55,8 +69,6 @@ static float mouseSens = 0.08f;
 static bool   firstMouse = true;
 static double lastMX = 0.0, lastMY = 0.0;
 static float  shakePhase = 0.0f;
-static float  wheelSteer = 0.0f;
-
 static glm::vec3 camPos = glm::vec3(0.0f, 1.10f, 0.35f);
 
 static void cursorPosCallback(GLFWwindow*, double mx, double my)
@@ -117,9 +129,18 @@ static unsigned int preprocessTexture(const char* filepath)
     return texture;
 }
 
-int main()
+int main(int argc, char** argv)
 {
-    srand((unsigned)time(nullptr));
+    const char* recordPath = nullptr;
+    const char* replayPath = nullptr;
+    bool smoothPath = false;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--record") && i + 1 < argc) recordPath = argv[++i];
+        else if (!strcmp(argv[i], "--replay") && i + 1 < argc) replayPath = argv[++i];
+        else if (!strcmp(argv[i], "--smooth")) smoothPath = true;
+    }
+
     if (!glfwInit()) return -1;
 
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -313,10 +334,27 @@ int main()
     rctx.COL_DOOR = COL_DOOR;
     rctx.COL_ROOF = COL_ROOF;
 
-    BusLogic logic;
-    double lastTime = glfwGetTime();
     const double TARGET_DT = 1.0 / 75.0;
 
+    // --replay drives the sim from a recording instead of the clock and the
+    // mouse, as fast as the sim thread can step; --record logs every sim
+    // step of a live session. --smooth drives the bus along the route spline;
+    // a replay takes the setting from the recording instead.
+    const BusGeometry& busGeometry = StandardBusGeometry();
+
+    SimThreadConfig simCfg;
+    simCfg.seed = (uint64_t)time(nullptr);
+    simCfg.startTime = glfwGetTime();
+    simCfg.recordPath = recordPath;
+    simCfg.replayPath = replayPath;
+    simCfg.smoothPath = smoothPath;
+    simCfg.geometry = &busGeometry;
+    simCfg.stepDt = SIM_DT;
+    simCfg.maxCatchUpSteps = MAX_SIM_STEPS;
+    simCfg.rewindBytes = REWIND_BYTES;
+    simCfg.rewindKeyframeInterval = REWIND_KEYFRAME_INTERVAL;
+    simCfg.rewindStep = REWIND_STEP;
+
     Model steeringWheel("res/Models/Steeringwheel.glb");
     Model controlModel("res/Models/control.fbx");
 
@@ -345,39 +383,40 @@ int main()
     for (const auto& path : fbxPaths)
         people.emplace_back(path);
 
-    while (!glfwWindowShouldClose(window))
-    {
-        double frameStart = glfwGetTime();
+    SimThread sim;
+    sim.start(simCfg);
+    if (replayPath && !sim.replaying()) std::cout << "Cannot load replay " << replayPath << std::endl;
+    if (recordPath && !sim.replaying() && !sim.recording()) std::cout << "Cannot record to " << recordPath << std::endl;
 
-        double now = glfwGetTime();
-        double dtSim = now - lastTime;
-        lastTime = now;
+    double lastClock = glfwGetTime();
+    SimFrame drawFrame;
 
-        logic.update(now, dtSim);
-        const auto& st = logic.state();
+    // Render work per frame (before the frame-rate wait), for comparing
+    // replays of the same recording.
+    long long framesDrawn = 0;
+    double frameSeconds = 0.0;
+    double worstFrame = 0.0;
 
-        int ii0 = st.currentRoutePoint;
-        int ii1 = (ii0 + 1) % ROUTE_POINT_COUNT;
-        int ii2 = (ii1 + 1) % ROUTE_POINT_COUNT;
+    while (!glfwWindowShouldClose(window))
+    {
+        double frameStart = glfwGetTime();
 
-        glm::vec2 a(route2D[ii0 * 2 + 0], route2D[ii0 * 2 + 1]);
-        glm::vec2 b(route2D[ii1 * 2 + 0], route2D[ii1 * 2 + 1]);
-        glm::vec2 c(route2D[ii2 * 2 + 0], route2D[ii2 * 2 + 1]);
+        double frameDt = frameStart - lastClock;
+        lastClock = frameStart;
 
-        glm::vec2 v1 = glm::normalize(b - a);
-        glm::vec2 v2 = glm::normalize(c - b);
+        if (sim.finished()) break;
 
-        float cross = v1.x * v2.y - v1.y * v2.x;
-        cross = glm::clamp(cross, -1.0f, 1.0f);
+        // The render loop only ever reads the newest published snapshot.
+        const RenderSnapshot& snap = sim.latest();
+        float alpha = (float)((SimThread::Clock() - snap.stepClock) / SIM_DT);
+        InterpolateSimFrames(snap.prev, snap.cur, glm::clamp(alpha, 0.0f, 1.0f), drawFrame);
 
-        float targetSteer = 0.0f;
-        if (!st.atStop) targetSteer = cross * 28.0f;
-        wheelSteer = glm::mix(wheelSteer, targetSteer, (float)(dtSim * 8.0));
+        const BusState& st = snap.state;
 
         float shakeY = 0.0f;
         if (!st.atStop)
         {
-            shakePhase += (float)(dtSim * 10.0f);
+            shakePhase += (float)(frameDt * 10.0f);
             shakeY = 0.008f * sinf(shakePhase) + 0.004f * sinf(shakePhase * 2.3f);
         }
         glm::vec3 busOffset = glm::vec3(0.55f, shakeY, 0.0f);
@@ -395,7 +434,7 @@ int main()
 
         glm::mat4 Vcam = glm::lookAt(camPos, camPos + front, glm::vec3(0, 1, 0));
 
-        glm::vec3 lightPos = glm::vec3(busOffset.x + 0.0f, busOffset.y + 1.55f, busOffset.z + 0.5f);
+        glm::vec3 lightPos = busOffset + busGeometry.lampPos;
 
         SceneState scene;
         scene.camPos = camPos;
@@ -403,15 +442,15 @@ int main()
         scene.P = P;
         scene.busOffset = busOffset;
         scene.lightPos = lightPos;
+        scene.bus = &busGeometry;
 
-        BusRender::DrawWorldAndBus(rctx, logic, scene);
+        BusRender::DrawWorldAndBus(rctx, st, scene);
 
-        BusRender::DrawSteeringWheel(rctx, scene, steeringWheel, wheelSteer, 25.0f);
+        BusRender::DrawSteeringWheel(rctx, scene, steeringWheel, drawFrame.wheelSteer, 25.0f);
 
         BusRender::DrawActors(rctx, scene, controlModel, people,
-            logic.insideActors(),
-            logic.hasMovingActor(),
-            logic.movingActor()
+            snap.inside,
+            drawFrame.moving
         );
 
         glBindVertexArray(0);
@@ -429,24 +468,10 @@ int main()
         glDrawArrays(GL_TRIANGLES, 0, 6);
         glBindVertexArray(0);
 
-        {
-            glm::mat4 PanelWorld = glm::translate(glm::mat4(1.0f), busOffset) * scene.PanelLocal;
-            hud.setPanel(PanelWorld, Vcam, P);
-        }
-
-        int i0 = st.currentRoutePoint;
-        int i1 = (i0 + 1) % ROUTE_POINT_COUNT;
-
-        float cx = route2D[i0 * 2 + 0];
-        float cy = route2D[i0 * 2 + 1];
-        float nx = route2D[i1 * 2 + 0];
-        float ny = route2D[i1 * 2 + 1];
-
-        float bx = cx + (nx - cx) * st.travelT;
-        float by = cy + (ny - cy) * st.travelT;
+        hud.setPanel(busGeometry, glm::translate(glm::mat4(1.0f), busOffset), Vcam, P);
 
         hud.drawRouteAndStops();
-        hud.drawBusMarker(bx, by);
+        hud.drawBusMarker(drawFrame.marker.x, drawFrame.marker.y);
         hud.drawDoorIcon(st.atStop);
         hud.drawControlIcon(st.controlInside);
         hud.drawPassengerCount(st.passengers);
@@ -461,16 +486,28 @@ int main()
         bool lmb = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
         bool rmb = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
         bool k = glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS;
+        bool b = glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS;
 
-        if (lmb && !prevLMB) logic.tryPassengerEnter();
-        if (rmb && !prevRMB) logic.tryPassengerExit();
-        if (k && !prevK)   logic.tryControlEnter();
+        if (!sim.replaying())
+        {
+            uint8_t commands = 0;
+            if (lmb && !prevLMB) commands |= CommandBit(SimCommand::PassengerEnter);
+            if (rmb && !prevRMB) commands |= CommandBit(SimCommand::PassengerExit);
+            if (k && !prevK)     commands |= CommandBit(SimCommand::ControlEnter);
+            if (commands) sim.pushCommands(commands);
+        }
+        if (b && !prevB) sim.requestRewind();
 
         prevLMB = lmb;
         prevRMB = rmb;
         prevK = k;
+        prevB = b;
 
         double dt = glfwGetTime() - frameStart;
+        framesDrawn++;
+        frameSeconds += dt;
+        worstFrame = std::max(worstFrame, dt);
+
         double remaining = TARGET_DT - dt;
         if (remaining > 0.0)
         {
@@ -483,6 +520,17 @@ int main()
         }
     }
 
+    sim.stop();
+    if (sim.replaying() && sim.stepsRun() > 0)
+    {
+        const BusState& st = sim.logic().state();
+        std::cout << "Replayed " << sim.stepsRun() << " sim steps, avg step " << (sim.busySeconds() / sim.stepsRun()) * 1000.0 << " ms"
+            << "; " << framesDrawn << " frames, avg frame " << (framesDrawn > 0 ? frameSeconds / framesDrawn : 0.0) * 1000.0
+            << " ms, worst " << worstFrame * 1000.0 << " ms"
+            << ", final point " << st.currentRoutePoint << ", passengers " << st.passengers
+            << ", fines " << st.totalFines << std::endl;
+    }
+
     if (nameTex) glDeleteTextures(1, &nameTex);
 
     for (int i = 0; i < 10; i++)
@@ -1,9 +1,12 @@
 #pragma once
 #include <GL/glew.h>
+#include "../../Shared/RouteDef.h"
 
-extern float routeVertices[24];
-extern int stopIndices[10];
-extern const int STOP_COUNT;
+constexpr int ROUTE_POINT_COUNT = RouteDef::BUS_ROUTE.pointCount;
+constexpr int STOP_COUNT = RouteDef::BUS_ROUTE.stopCount;
+
+constexpr const float* routeVertices = RouteDef::BUS_ROUTE.points2D;
+constexpr const int* stopIndices = RouteDef::BUS_ROUTE.stopIndices;
 
 extern unsigned int VAOroute;
 extern unsigned int VAOcircle;
@@ -154,7 +154,7 @@ int main()
         }
 
         // BUS MOVEMENT LOGIC (unchanged)
-        int nextRoutePoint = (currentRoutePoint + 1) % 12;
+        int nextRoutePoint = (currentRoutePoint + 1) % ROUTE_POINT_COUNT;
         float cx = routeVertices[currentRoutePoint * 2];
         float cy = routeVertices[currentRoutePoint * 2 + 1];
         float nx = routeVertices[nextRoutePoint * 2];
@@ -171,7 +171,7 @@ int main()
         else
         {
             float worldSpeed = 0.25f;
-            float len = sqrt((nx - cx) * (nx - cx) + (ny - cy) * (ny - cy));
+            float len = RouteDef::BUS_ROUTE.segmentLength[currentRoutePoint];
             travelT += (worldSpeed / len) * deltaTime;
 
 
@@ -180,29 +180,26 @@ int main()
                 travelT = 0.0f;
                 currentRoutePoint = nextRoutePoint;
 
-                for (int i = 0; i < STOP_COUNT; i++)
-                    if (stopIndices[i] == currentRoutePoint)
-                    {
-                        atStop = true;
-                        stopStartTime = currentTime;
+                if (RouteDef::BUS_ROUTE.isStop(currentRoutePoint))
+                {
+                    atStop = true;
+                    stopStartTime = currentTime;
 
-                        if (controlInBus)
+                    if (controlInBus)
+                    {
+                        if (passengers > 1)
                         {
-                            if (passengers > 1)
-                            {
-                                int maxFines = passengers - 1;          // broj “pravih” putnika
-                                int numFines = (maxFines > 0) ? (rand() % (maxFines + 1)) : 0;  // 0..maxFines
-                                totalFines += numFines;
+                            int maxFines = passengers - 1;          // broj “pravih” putnika
+                            int numFines = (maxFines > 0) ? (rand() % (maxFines + 1)) : 0;  // 0..maxFines
+                            totalFines += numFines;
 
-                            }
-
-                            passengers--; // kontrola izlazi
-                            controlInBus = false;
-                            std::cout << "Kontrola izasla. Kazne: " << totalFines << std::endl;
                         }
 
-                        break;
+                        passengers--; // kontrola izlazi
+                        controlInBus = false;
+                        std::cout << "Kontrola izasla. Kazne: " << totalFines << std::endl;
                     }
+                }
 
             }
         }
@@ -3,24 +3,6 @@
 
 #define NUM_SLICES 32
 
-float routeVertices[24] = {
-    -0.6f, -0.7f,
-     0.3f, -0.5f,
-     0.4f, -0.2f,
-     0.4f,  0.0f,
-     0.6f,  0.1f,
-     0.6f,  0.4f,
-     0.4f,  0.4f,
-     0.4f,  0.6f,
-    -0.1f,  0.7f,
-    -0.3f,  0.6f,
-    -0.6f,  0.6f,
-    -0.5f,  0.0f,
-};
-
-int stopIndices[10] = { 0,1,2,4,5,7,8,9,10,11 };
-const int STOP_COUNT = 10;
-
 unsigned int VAOroute, VBOroute;
 
 unsigned int VAOcircle, VBOcircle;
@@ -32,7 +14,7 @@ void initRouteVAO()
 
     glBindVertexArray(VAOroute);
     glBindBuffer(GL_ARRAY_BUFFER, VBOroute);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(routeVertices), routeVertices, GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, ROUTE_POINT_COUNT * 2 * sizeof(float), routeVertices, GL_STATIC_DRAW);
 
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
@@ -43,7 +25,7 @@ void drawRoute(unsigned int shader)
     glUseProgram(shader);
     glBindVertexArray(VAOroute);
     glLineWidth(5.0f);
-    glDrawArrays(GL_LINE_LOOP, 0, 12);
+    glDrawArrays(GL_LINE_LOOP, 0, ROUTE_POINT_COUNT);
 }
 
 void initCircleVAO()
@@ -0,0 +1,108 @@
+#pragma once
+#include <cstdint>
+
+// Compile-time route definition shared by Autobus-3D and Kostur. A route is
+// a closed loop of 2D points (panel units) plus the indices of the points
+// that are stops; CompileRoute() derives every lookup table the simulation
+// needs, so nothing is built or searched at run time.
+namespace RouteDef
+{
+    struct Point2 { float x, y; };
+
+    constexpr float ConstSqrt(float v)
+    {
+        if (v <= 0.0f) return 0.0f;
+        double x = (v > 1.0f) ? (double)v : 1.0;
+        for (int i = 0; i < 64; i++) x = 0.5 * (x + (double)v / x);
+        return (float)x;
+    }
+
+    // Stops must be strictly increasing indices of existing route points.
+    constexpr bool StopsValid(const int* stops, int stopCount, int pointCount)
+    {
+        if (stopCount <= 0 || stopCount > pointCount) return false;
+        for (int i = 0; i < stopCount; i++)
+        {
+            if (stops[i] < 0 || stops[i] >= pointCount) return false;
+            if (i > 0 && stops[i] <= stops[i - 1]) return false;
+        }
+        return true;
+    }
+
+    template <int N, int S>
+    struct CompiledRoute
+    {
+        static constexpr int pointCount = N;
+        static constexpr int stopCount = S;
+
+        float points2D[N * 2] = {};
+        int stopIndices[S] = {};
+
+        uint32_t stopBitmap[(N + 31) / 32] = {};
+        int stopNumber[N] = {};          // -1 for points that are not stops
+
+        float segmentLength[N] = {};     // point i -> point i + 1, panel units
+        float headingX[N] = {};          // unit direction of segment i
+        float headingY[N] = {};
+
+        constexpr bool isStop(int idx) const { return ((stopBitmap[idx >> 5] >> (idx & 31)) & 1u) != 0; }
+    };
+
+    template <int N, int S>
+    constexpr CompiledRoute<N, S> CompileRoute(const Point2 (&points)[N], const int (&stops)[S])
+    {
+        CompiledRoute<N, S> r{};
+
+        for (int i = 0; i < N; i++)
+        {
+            r.points2D[i * 2 + 0] = points[i].x;
+            r.points2D[i * 2 + 1] = points[i].y;
+            r.stopNumber[i] = -1;
+        }
+
+        for (int i = 0; i < S; i++)
+        {
+            r.stopIndices[i] = stops[i];
+            r.stopBitmap[stops[i] >> 5] |= 1u << (stops[i] & 31);
+            r.stopNumber[stops[i]] = i;
+        }
+
+        for (int i = 0; i < N; i++)
+        {
+            const Point2& a = points[i];
+            const Point2& b = points[(i + 1) % N];
+            float dx = b.x - a.x;
+            float dy = b.y - a.y;
+            float len = ConstSqrt(dx * dx + dy * dy);
+
+            r.segmentLength[i] = len;
+            r.headingX[i] = (len > 1e-6f) ? dx / len : 0.0f;
+            r.headingY[i] = (len > 1e-6f) ? dy / len : 0.0f;
+        }
+
+        return r;
+    }
+
+    constexpr Point2 BUS_ROUTE_POINTS[] = {
+        { -0.6f, -0.7f },
+        {  0.3f, -0.5f },
+        {  0.4f, -0.2f },
+        {  0.4f,  0.0f },
+        {  0.6f,  0.1f },
+        {  0.6f,  0.4f },
+        {  0.4f,  0.4f },
+        {  0.4f,  0.6f },
+        { -0.1f,  0.7f },
+        { -0.3f,  0.6f },
+        { -0.6f,  0.6f },
+        { -0.5f,  0.0f },
+    };
+
+    constexpr int BUS_ROUTE_STOPS[] = { 0,1,2,4,5,7,8,9,10,11 };
+
+    static_assert(StopsValid(BUS_ROUTE_STOPS, sizeof(BUS_ROUTE_STOPS) / sizeof(BUS_ROUTE_STOPS[0]),
+        sizeof(BUS_ROUTE_POINTS) / sizeof(BUS_ROUTE_POINTS[0])),
+        "bus route stops must be strictly increasing route point indices");
+
+    constexpr auto BUS_ROUTE = CompileRoute(BUS_ROUTE_POINTS, BUS_ROUTE_STOPS);
+}